@@ -0,0 +1,558 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include "Bagging.hpp"
+#include "DataReader.hpp"
+#include "Dataset.hpp"
+#include "Distributed.hpp"
+#include "Memory.hpp"
+#include "ThreadPool.hpp"
+#include "Tuning.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+	struct Arguments {
+		std::string mode;
+		Dataset dataset;
+		BaggingOptions bagging;
+		ParameterGrid grid;
+		SearchOptions search;
+		bool json = false;
+		std::string model;
+		std::string save;
+		size_t window = 0;
+		size_t workers = 1;
+		std::pair<size_t, size_t> slice{ 0, 0 };
+		std::vector<std::string> slices;
+		std::string data;
+		std::string output;
+		std::string report;
+		std::string baseline;
+		double threshold = 0.10;
+		size_t cache = 0;
+		// a negative alpha is chosen on the validation rows of prune
+		double alpha = -1;
+		std::string pruning = "cost-complexity";
+		size_t points = 10;
+	};
+
+	void usage() {
+		std::cerr << "Usage: DecisionTreeCli train --train FILE --test FILE [--label NAME] [--trees N] [--seed N]\n"
+			<< "                          [--threads N] [--memory-budget BYTES] [--time-budget SECONDS]\n"
+			<< "                          [--save MODEL]\n"
+			<< "                          [--report FILE] [--baseline FILE] [--threshold FRACTION]\n"
+			<< "                          [--workers N | --slices FILE,FILE...]\n"
+			<< "                          [--patience N] [--stop-metric accuracy|logloss]\n"
+			<< "                          [--max-depth N] [--min-rows-split N] [--train-strings keep|drop]\n"
+			<< "                          [--splits best|random]\n"
+			<< "       DecisionTreeCli search --train FILE --test FILE [--label NAME] [--trees N,N...]\n"
+			<< "                          [--max-depth N,N...] [--min-rows-split N,N...] [--folds K]\n"
+			<< "                          [--random N] [--seed N] [--threads N] [--format table|json]\n"
+			<< "                          [--splits best|random]\n"
+			<< "       DecisionTreeCli worker --train FILE --test FILE [--label NAME] --trees N [--seed N]\n"
+			<< "                          --slice BEGIN:END [--threads N] [--output FILE]\n"
+			<< "       DecisionTreeCli grow --model MODEL --train FILE --test FILE [--label NAME] [--trees N]\n"
+			<< "                         [--window N] [--threads N] [--time-budget SECONDS]\n"
+			<< "                         [--save MODEL]\n"
+			<< "       DecisionTreeCli evaluate --model MODEL --data FILE\n"
+			<< "       DecisionTreeCli score --model MODEL --data FILE [--output FILE] [--cache ENTRIES]\n"
+			<< "       DecisionTreeCli prune --model MODEL --data FILE [--method cost-complexity|reduced-error]\n"
+			<< "                          [--alpha A] [--points N] [--save MODEL]\n"
+			<< "       DecisionTreeCli compact --model MODEL\n"
+			<< "       DecisionTreeCli compare --report FILE --baseline FILE [--threshold FRACTION]\n"
+			<< "train prints a JSON performance report, or writes it to --report. With --baseline the\n"
+			<< "report is compared as in compare mode. compare exits with 1 when a timing is slower, or\n"
+			<< "the prediction throughput lower, than the baseline by more than the threshold (0.10).\n"
+			<< "The data files of evaluate and score are ARFF or CSV with a header line, their columns\n"
+			<< "are matched to the model by name. grow adds N trees trained on the data set to a saved\n"
+			<< "model and keeps the newest --window trees, --save defaults to overwriting the model. The new\n"
+			<< "trees continue the seeds of the model, which saves its seed and the number of seeds drawn.\n"
+			<< "train --workers N trains the ensemble in N forked processes. worker trains the trees\n"
+			<< "[BEGIN, END) of the ensemble, on any host, and train --slices merges their outputs. In both\n"
+			<< "cases the model is identical to a single process training with the same --trees and --seed.\n"
+			<< "With --patience training stops once the out-of-bag signal did not improve for N trees.\n"
+			<< "With --time-budget --trees is the largest number of trees: no tree is started unless the mean\n"
+			<< "build time so far fits in the time left, and the trees built are kept. The limit is soft:\n"
+			<< "the trees already started are finished, so the training can run past it.\n"
+			<< "--train-strings drop frees the training rows once they are encoded; out-of-bag early stopping needs them.\n"
+			<< "search cross-validates every combination of the values given, or --random N of them,\n"
+			<< "on the training data set and prints the results sorted by accuracy.\n"
+			<< "--splits random trains Extra-Trees: every node keeps the best of one random question per column.\n"
+			<< "prune prints the node count and accuracy on the --data rows along the alpha path, then\n"
+			<< "prunes the trees with --alpha, by default the most accurate alpha of the path, or with\n"
+			<< "reduced-error pruning on the --data rows. --save defaults to overwriting the model.\n"
+			<< "compact measures how much sharing the identical subtrees of the trees of a model saves in\n"
+			<< "memory; the model file is not changed, saved models always hold every tree in full.\n";
+	}
+
+	std::pair<size_t, size_t> parseSlice(const std::string& value) {
+		const size_t colon = value.find(':');
+		if (colon == std::string::npos)
+			throw std::invalid_argument("--slice expects BEGIN:END");
+		return { std::stoul(value.substr(0, colon)), std::stoul(value.substr(colon + 1)) };
+	}
+
+	// comma separated values, for the parameters a search takes several values of
+	template<typename T>
+	std::vector<T> parseList(const std::string& value) {
+		VecS items;
+		std::vector<T> values;
+		boost::split(items, value, boost::is_any_of(","));
+		for (const auto& item : items)
+			values.push_back(static_cast<T>(std::stoll(item)));
+		return values;
+	}
+
+	EarlyStopping::Metric parseMetric(const std::string& value) {
+		if (value == "accuracy")
+			return EarlyStopping::Accuracy;
+		if (value == "logloss")
+			return EarlyStopping::LogLoss;
+		throw std::invalid_argument("--stop-metric expects accuracy or logloss");
+	}
+
+	bool parseSplits(const std::string& value) {
+		if (value == "best")
+			return false;
+		if (value == "random")
+			return true;
+		throw std::invalid_argument("--splits expects best or random");
+	}
+
+	Arguments parseArguments(int argc, char* argv[]) {
+		Arguments args;
+		if (argc < 2)
+			throw std::invalid_argument("Missing mode");
+		args.mode = argv[1];
+		for (int i = 2; i < argc; i++) {
+			std::string arg = argv[i];
+			if (i + 1 >= argc)
+				throw std::invalid_argument("Missing value for " + arg);
+			std::string value = argv[++i];
+			if (arg == "--train") args.dataset.train.filename = value;
+			else if (arg == "--test") args.dataset.test.filename = value;
+			else if (arg == "--label") args.dataset.classLabel = value;
+			else if (arg == "--train-strings") args.dataset.keepTrainStrings = value != "drop";
+			else if (arg == "--trees") args.bagging.ensembleSize = (args.grid.ensembleSize = parseList<int>(value)).front();
+			else if (arg == "--max-depth") args.bagging.tree.maxDepth = (args.grid.maxDepth = parseList<size_t>(value)).front();
+			else if (arg == "--splits") args.bagging.tree.extraTrees = parseSplits(value);
+			else if (arg == "--min-rows-split") args.bagging.tree.minRowsSplit = (args.grid.minRowsSplit = parseList<size_t>(value)).front();
+			else if (arg == "--folds") args.search.folds = std::stoul(value);
+			else if (arg == "--random") args.search.randomSamples = std::stoul(value);
+			else if (arg == "--format") args.json = value == "json";
+			else if (arg == "--seed") args.bagging.seed = std::stoul(value);
+			else if (arg == "--threads") args.search.threads = args.bagging.threads = std::max<size_t>(1, std::stoul(value));
+			else if (arg == "--memory-budget") args.bagging.memoryBudget = std::stoull(value);
+			else if (arg == "--time-budget") args.bagging.timeBudget = std::stod(value);
+			else if (arg == "--save") args.save = value;
+			else if (arg == "--window") args.window = std::stoul(value);
+			else if (arg == "--patience") args.bagging.earlyStopping.patience = std::stoul(value);
+			else if (arg == "--stop-metric") args.bagging.earlyStopping.metric = parseMetric(value);
+			else if (arg == "--workers") args.workers = std::max<size_t>(1, std::stoul(value));
+			else if (arg == "--slice") args.slice = parseSlice(value);
+			else if (arg == "--slices") boost::split(args.slices, value, boost::is_any_of(","));
+			else if (arg == "--model") args.model = value;
+			else if (arg == "--data") args.data = value;
+			else if (arg == "--output") args.output = value;
+			else if (arg == "--report") args.report = value;
+			else if (arg == "--baseline") args.baseline = value;
+			else if (arg == "--threshold") args.threshold = std::stod(value);
+			else if (arg == "--cache") args.cache = std::stoul(value);
+			else if (arg == "--alpha") args.alpha = std::stod(value);
+			else if (arg == "--method") args.pruning = value;
+			else if (arg == "--points") args.points = std::max<size_t>(2, std::stoul(value));
+			else throw std::invalid_argument("Unknown argument " + arg);
+		}
+		if (args.mode == "train" && (args.dataset.train.filename.empty() || args.dataset.test.filename.empty()))
+			throw std::invalid_argument("train requires --train and --test");
+		if (args.mode == "search" && (args.dataset.train.filename.empty() || args.dataset.test.filename.empty()))
+			throw std::invalid_argument("search requires --train and --test");
+		if (args.mode == "worker" && (args.dataset.train.filename.empty() || args.dataset.test.filename.empty() || args.slice.second == 0))
+			throw std::invalid_argument("worker requires --train, --test and --slice");
+		if (args.mode == "grow" && (args.model.empty() || args.dataset.train.filename.empty() || args.dataset.test.filename.empty()))
+			throw std::invalid_argument("grow requires --model, --train and --test");
+		if ((args.mode == "evaluate" || args.mode == "score" || args.mode == "prune") && (args.model.empty() || args.data.empty()))
+			throw std::invalid_argument(args.mode + " requires --model and --data");
+		if (args.mode == "prune" && args.pruning != "cost-complexity" && args.pruning != "reduced-error")
+			throw std::invalid_argument("--method expects cost-complexity or reduced-error");
+		if (args.mode == "compact" && args.model.empty())
+			throw std::invalid_argument("compact requires --model");
+		if (args.mode == "compare" && (args.report.empty() || args.baseline.empty()))
+			throw std::invalid_argument("compare requires --report and --baseline");
+		if (args.mode != "train" && args.mode != "search" && args.mode != "worker" && args.mode != "grow" && args.mode != "evaluate" && args.mode != "score" && args.mode != "prune" && args.mode != "compact" && args.mode != "compare")
+			throw std::invalid_argument("Unknown mode " + args.mode);
+		return args;
+	}
+
+	double seconds(uint64_t nanoseconds) {
+		return nanoseconds / 1e9;
+	}
+
+	// reads the column names and rows of an ARFF file, or of a CSV file whose first line holds the column names
+	std::pair<VecS, Data> readTable(const std::string& filename) {
+		std::ifstream file(filename);
+		if (!file)
+			throw std::runtime_error("Can't open file: " + filename);
+		const bool arff = boost::iends_with(filename, ".arff");
+		VecS columns;
+		Data rows;
+		bool data = !arff;
+		bool header = !arff;
+		std::string line;
+		while (std::getline(file, line)) {
+			boost::trim(line);
+			if (line.empty() || line[0] == '%')
+				continue;
+			if (!data) {
+				if (boost::istarts_with(line, "@attribute")) {
+					// the name is the first word after the keyword, the type is not needed to map the columns
+					std::string rest = boost::trim_copy(line.substr(std::string("@attribute").size()));
+					columns.push_back(rest.substr(0, rest.find_first_of(" \t{")));
+				}
+				else if (boost::istarts_with(line, "@data")) {
+					data = true;
+				}
+				continue;
+			}
+			VecS values;
+			boost::split(values, line, boost::is_any_of(","));
+			for (auto& value : values)
+				boost::trim(value);
+			if (header) {
+				columns = std::move(values);
+				header = false;
+			}
+			else {
+				rows.push_back(std::move(values));
+			}
+		}
+		return { columns, rows };
+	}
+
+	// reorders the rows to the columns of the model, the class column is left empty when the file has none
+	Data alignRows(const MetaData& meta, const VecS& columns, const Data& rows, bool requireClass) {
+		std::vector<int> source(meta.labels.size(), -1);
+		for (size_t col = 0; col < meta.labels.size(); col++) {
+			for (size_t i = 0; i < columns.size(); i++) {
+				if (columns[i] == meta.labels[col])
+					source[col] = i;
+			}
+			const bool isClass = col + 1 == meta.labels.size();
+			if (source[col] < 0 && (!isClass || requireClass))
+				throw std::runtime_error("Missing column " + meta.labels[col]);
+		}
+		Data aligned;
+		aligned.reserve(rows.size());
+		for (const auto& row : rows) {
+			VecS values(meta.labels.size());
+			for (size_t col = 0; col < source.size(); col++) {
+				if (source[col] >= 0) {
+					if ((size_t)source[col] >= row.size())
+						throw std::runtime_error("Row with " + std::to_string(row.size()) + " values");
+					values[col] = row[source[col]];
+				}
+			}
+			aligned.push_back(std::move(values));
+		}
+		return aligned;
+	}
+
+	// reads the numbers of the top level keys of a flat JSON object, other values are skipped
+	std::map<std::string, double> readNumbers(const std::string& filename) {
+		std::ifstream file(filename);
+		if (!file)
+			throw std::runtime_error("Can't open file: " + filename);
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		const std::string json = buffer.str();
+		std::map<std::string, double> numbers;
+		int depth = 0;
+		for (size_t i = 0; i < json.size(); i++) {
+			const char c = json[i];
+			if (c == '{' || c == '[') {
+				depth++;
+			}
+			else if (c == '}' || c == ']') {
+				depth--;
+			}
+			else if (c == '"') {
+				const size_t end = json.find('"', i + 1);
+				if (end == std::string::npos)
+					break;
+				const std::string key = json.substr(i + 1, end - i - 1);
+				i = end;
+				const size_t colon = json.find_first_not_of(" \t\r\n", end + 1);
+				if (depth != 1 || colon == std::string::npos || json[colon] != ':')
+					continue;
+				const size_t start = json.find_first_not_of(" \t\r\n", colon + 1);
+				if (start == std::string::npos)
+					break;
+				char* last = nullptr;
+				const double value = std::strtod(json.c_str() + start, &last);
+				if (last != json.c_str() + start) {
+					numbers[key] = value;
+					i = last - json.c_str() - 1;
+				}
+			}
+		}
+		return numbers;
+	}
+
+	// compares a report to a baseline, returns false when a metric regressed beyond the threshold
+	bool compare(const std::string& reportFile, const std::string& baselineFile, double threshold) {
+		const auto report = readNumbers(reportFile);
+		const auto baseline = readNumbers(baselineFile);
+		// timings are better when lower, the throughput when higher
+		const std::vector<std::pair<std::string, bool>> metrics = {
+			{ "load_s", true }, { "encode_s", true }, { "build_s", true }, { "predict_rows_per_s", false } };
+		bool passed = true;
+		for (const auto& [name, lowerIsBetter] : metrics) {
+			const auto r = report.find(name);
+			const auto b = baseline.find(name);
+			if (r == report.end() || b == baseline.end() || b->second <= 0) {
+				std::cerr << name << ": not in both reports, skipped\n";
+				continue;
+			}
+			const double change = (r->second - b->second) / b->second;
+			const bool regressed = lowerIsBetter ? change > threshold : -change > threshold;
+			std::cerr << name << ": " << b->second << " -> " << r->second << " (" << (change >= 0 ? "+" : "")
+				<< change * 100 << "%)" << (regressed ? " REGRESSION" : "") << "\n";
+			passed = passed && !regressed;
+		}
+		return passed;
+	}
+
+	Bagging mergeSlices(const DataReader& dr, const Arguments& args) {
+		std::vector<std::ifstream> files;
+		std::vector<std::istream*> inputs;
+		for (const auto& filename : args.slices) {
+			files.emplace_back(filename);
+			if (!files.back())
+				throw std::runtime_error("Can't open file: " + filename);
+		}
+		for (auto& file : files)
+			inputs.push_back(&file);
+		return Distributed::merge(dr, args.bagging, inputs);
+	}
+
+	int search(const Arguments& args) {
+		DataReader dr(args.dataset);
+		SearchOptions options = args.search;
+		options.seed = args.bagging.seed;
+		const auto results = Tuning::search(dr, args.grid, args.bagging, options);
+		std::cout << (args.json ? Tuning::toJson(results) + "\n" : Tuning::toTable(results)) << std::flush;
+		return 0;
+	}
+
+	int worker(const Arguments& args) {
+		DataReader dr(args.dataset);
+		std::ofstream file;
+		if (!args.output.empty()) {
+			file.open(args.output);
+			if (!file)
+				throw std::runtime_error("Can't write file: " + args.output);
+		}
+		Bagging::trainSlice(dr, args.bagging, args.slice.first, args.slice.second, args.output.empty() ? std::cout : file);
+		return 0;
+	}
+
+	int train(const Arguments& args) {
+		DataReader dr(args.dataset);
+		const auto buildStart = Clock::now();
+		Bagging model = !args.slices.empty() ? mergeSlices(dr, args)
+			: args.workers > 1 ? Distributed::train(dr, args.bagging, args.workers)
+			: Bagging(dr, args.bagging);
+		const double buildSeconds = std::chrono::duration<double>(Clock::now() - buildStart).count();
+		// the layout of the trees follows the branches taken by the training rows
+		const auto compileStart = Clock::now();
+		model.compile(dr.trainData());
+		const double compileSeconds = std::chrono::duration<double>(Clock::now() - compileStart).count();
+
+		ThreadPool pool(args.bagging.threads);
+		const Data& testData = dr.testData();
+		const auto predictStart = Clock::now();
+		const double accuracy = model.accuracy(testData, pool);
+		const double predictSeconds = std::chrono::duration<double>(Clock::now() - predictStart).count();
+
+		if (!args.save.empty())
+			model.save(args.save);
+
+		const auto& metrics = model.trainingMetrics();
+		std::ostringstream report;
+		report << "{\"trees\": " << model.size()
+			<< ", \"threads\": " << args.bagging.threads
+			<< ", \"workers\": " << args.workers
+			<< ", \"seed\": " << args.bagging.seed
+			<< ", \"train_rows\": " << dr.trainDataInt().size()
+			<< ", \"test_rows\": " << testData.size()
+			<< ", \"load_s\": " << seconds(metrics.phases.wallNs[Metrics::Load].value())
+			<< ", \"encode_s\": " << seconds(metrics.phases.wallNs[Metrics::Encode].value())
+			<< ", \"build_s\": " << buildSeconds
+			<< ", \"build_s_per_tree\": [";
+		for (size_t i = 0; i < metrics.trees.size(); i++)
+			report << (i == 0 ? "" : ", ") << seconds(metrics.trees[i].wallNs.value());
+		report << "], \"compile_s\": " << compileSeconds
+			<< ", \"predict_s\": " << predictSeconds
+			<< ", \"predict_rows_per_s\": " << (predictSeconds > 0 ? testData.size() / predictSeconds : 0)
+			<< ", \"accuracy\": " << accuracy
+			<< ", \"model_bytes\": " << model.memoryReport().modelBytes()
+			<< ", \"early_stopping\": " << model.earlyStoppingReport().toJson()
+			<< ", \"time_budget\": " << model.timeBudgetReport().toJson()
+			<< ", \"peak_rss_bytes\": " << Memory::peakRssBytes() << "}";
+
+		if (args.report.empty()) {
+			std::cout << report.str() << std::endl;
+		}
+		else {
+			std::ofstream file(args.report);
+			file << report.str() << "\n";
+			if (!file)
+				throw std::runtime_error("Can't write file: " + args.report);
+		}
+		if (!args.baseline.empty()) {
+			if (args.report.empty())
+				throw std::invalid_argument("--baseline requires --report");
+			return compare(args.report, args.baseline, args.threshold) ? 0 : 1;
+		}
+		return 0;
+	}
+
+	int grow(const Arguments& args) {
+		Bagging model = Bagging::load(args.model);
+		const size_t before = model.size();
+		DataReader dr(args.dataset);
+		const auto buildStart = Clock::now();
+		const size_t added = model.grow(dr, args.bagging, args.window);
+		const double buildSeconds = std::chrono::duration<double>(Clock::now() - buildStart).count();
+		model.compile(dr.trainData());
+		ThreadPool pool(args.bagging.threads);
+		const double accuracy = model.accuracy(dr.testData(), pool);
+		model.save(args.save.empty() ? args.model : args.save);
+		std::cout << "{\"trees_before\": " << before
+			<< ", \"trees_added\": " << added
+			<< ", \"trees\": " << model.size()
+			<< ", \"build_s\": " << buildSeconds
+			<< ", \"accuracy\": " << accuracy << "}" << std::endl;
+		return 0;
+	}
+
+	int evaluate(const Arguments& args) {
+		Bagging model = Bagging::load(args.model);
+		model.compile();
+		const auto [columns, rows] = readTable(args.data);
+		ThreadPool pool(args.bagging.threads);
+		const Data aligned = alignRows(model.metaData(), columns, rows, true);
+		std::cout << "{\"rows\": " << aligned.size() << ", \"accuracy\": " << model.accuracy(aligned, pool) << "}" << std::endl;
+		return 0;
+	}
+
+	int score(const Arguments& args) {
+		Bagging model = Bagging::load(args.model);
+		model.compile();
+		if (args.cache > 0)
+			model.enableCache(args.cache);
+		const auto [columns, rows] = readTable(args.data);
+		ThreadPool pool(args.bagging.threads);
+		const VecS predictions = model.predict(alignRows(model.metaData(), columns, rows, false), pool);
+		std::ofstream file;
+		if (!args.output.empty()) {
+			file.open(args.output);
+			if (!file)
+				throw std::runtime_error("Can't write file: " + args.output);
+		}
+		std::ostream& out = args.output.empty() ? std::cout : file;
+		for (const auto& prediction : predictions)
+			out << prediction << "\n";
+		if (const PredictionCache* cache = model.predictionCache())
+			std::cerr << cache->toJson() << std::endl;
+		return 0;
+	}
+
+	int compact(const Arguments& args) {
+		Bagging model = Bagging::load(args.model);
+		std::cout << model.compact().toJson() << std::endl;
+		return 0;
+	}
+
+	int prune(const Arguments& args) {
+		Bagging model = Bagging::load(args.model);
+		const auto [columns, rows] = readTable(args.data);
+		const Data validation = alignRows(model.metaData(), columns, rows, true);
+		ThreadPool pool(args.bagging.threads);
+		const size_t nodesBefore = model.nodeCount();
+		const double accuracyBefore = model.accuracy(validation, pool);
+
+		const std::vector<PruningStep> path = model.pruningPath(validation, args.points);
+		double alpha = args.alpha;
+		if (args.pruning == "reduced-error") {
+			model.prune(validation);
+		}
+		else {
+			// the most accurate point of the path, the smallest ensemble among equally accurate ones
+			if (alpha < 0) {
+				const PruningStep* best = &path.front();
+				for (const auto& step : path) {
+					if (step.validationAccuracy >= best->validationAccuracy)
+						best = &step;
+				}
+				alpha = best->alpha;
+			}
+			model.prune(alpha);
+		}
+		model.compile();
+		const double accuracyAfter = model.accuracy(validation, pool);
+		model.save(args.save.empty() ? args.model : args.save);
+		std::cout << "{\"method\": \"" << args.pruning << "\""
+			<< ", \"alpha\": " << (args.pruning == "reduced-error" ? 0.0 : alpha)
+			<< ", \"nodes_before\": " << nodesBefore
+			<< ", \"nodes_after\": " << model.nodeCount()
+			<< ", \"accuracy_before\": " << accuracyBefore
+			<< ", \"accuracy_after\": " << accuracyAfter
+			<< ", \"path\": " << Pruning::toJson(path) << "}" << std::endl;
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Arguments args;
+	try {
+		args = parseArguments(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		usage();
+		return 2;
+	}
+
+	try {
+		if (args.mode == "train")
+			return train(args);
+		if (args.mode == "search")
+			return search(args);
+		if (args.mode == "worker")
+			return worker(args);
+		if (args.mode == "grow")
+			return grow(args);
+		if (args.mode == "evaluate")
+			return evaluate(args);
+		if (args.mode == "score")
+			return score(args);
+		if (args.mode == "prune")
+			return prune(args);
+		if (args.mode == "compact")
+			return compact(args);
+		return compare(args.report, args.baseline, args.threshold) ? 0 : 1;
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 2;
+	}
+}
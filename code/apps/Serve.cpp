@@ -0,0 +1,252 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Bagging.hpp"
+#include "DataReader.hpp"
+#include "Dataset.hpp"
+#include "PredictionServer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+	struct Arguments {
+		Dataset dataset;
+		// a model written by DecisionTreeCli train --save, served instead of training one
+		std::string model;
+		int trees = 10;
+		uint seed = 1234;
+		std::string socket;
+		ServerOptions server;
+		size_t loadTestClients = 0;
+		size_t loadTestRequests = 100000;
+		size_t loadTestWindow = 16;
+		size_t cache = 0;
+	};
+
+	void usage() {
+		std::cerr << "Usage: DecisionTreeServe (--train FILE --test FILE | --model FILE) [--label NAME] [--trees N] [--seed N]\n"
+			<< "                         [--socket PATH] [--max-batch N] [--max-wait-us N] [--threads N]\n"
+			<< "                         [--load-test CLIENTS] [--requests N] [--window N] [--cache ENTRIES]\n"
+			<< "Without --socket the model is served on stdin/stdout. With --load-test the server is\n"
+			<< "started on the socket and CLIENTS concurrent connections replay the test data set,\n"
+			<< "each keeping at most N requests in flight.\n"
+			<< "With --model the saved model is served and no tree is trained; --train and --test are then\n"
+			<< "optional, the training rows guide the layout of the trees and --load-test replays the test rows.\n";
+	}
+
+	Arguments parseArguments(int argc, char* argv[]) {
+		Arguments args;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if (i + 1 >= argc)
+				throw std::invalid_argument("Missing value for " + arg);
+			std::string value = argv[++i];
+			if (arg == "--train") args.dataset.train.filename = value;
+			else if (arg == "--test") args.dataset.test.filename = value;
+			else if (arg == "--model") args.model = value;
+			else if (arg == "--label") args.dataset.classLabel = value;
+			else if (arg == "--trees") args.trees = std::stoi(value);
+			else if (arg == "--seed") args.seed = std::stoul(value);
+			else if (arg == "--socket") args.socket = value;
+			else if (arg == "--max-batch") args.server.maxBatchSize = std::stoul(value);
+			else if (arg == "--max-wait-us") args.server.maxWait = std::chrono::microseconds(std::stol(value));
+			else if (arg == "--threads") args.server.threads = std::stoul(value);
+			else if (arg == "--load-test") args.loadTestClients = std::stoul(value);
+			else if (arg == "--requests") args.loadTestRequests = std::stoul(value);
+			else if (arg == "--window") args.loadTestWindow = std::max<size_t>(1, std::stoul(value));
+			else if (arg == "--cache") args.cache = std::stoul(value);
+			else throw std::invalid_argument("Unknown argument " + arg);
+		}
+		const bool data = !args.dataset.train.filename.empty() && !args.dataset.test.filename.empty();
+		if (!data && (args.model.empty() || !args.dataset.train.filename.empty() || !args.dataset.test.filename.empty()))
+			throw std::invalid_argument("--train and --test are required, together, unless a --model is served");
+		if (!data && args.loadTestClients > 0)
+			throw std::invalid_argument("--load-test requires --train and --test");
+		if (args.loadTestClients > 0 && args.socket.empty())
+			throw std::invalid_argument("--load-test requires --socket");
+		return args;
+	}
+
+	int connectTo(const std::string& path) {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		// the server thread might not be listening yet
+		for (int attempt = 0; attempt < 100; attempt++) {
+			int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+				return fd;
+			::close(fd);
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		throw std::runtime_error("Can't connect to " + path);
+	}
+
+	// replay rows of the test data over one connection, returns the latency of every request in microseconds
+	std::vector<double> runClient(const std::string& path, const Data& rows, size_t first, size_t count, size_t window) {
+		int fd = connectTo(path);
+		std::vector<Clock::time_point> sent(count);
+		std::vector<double> latencies;
+		std::atomic<size_t> received(0);
+		latencies.reserve(count);
+
+		std::thread sender([&]() {
+			for (size_t i = 0; i < count; i++) {
+				const auto& row = rows[(first + i) % rows.size()];
+				std::string line;
+				// the class value in the last column is not sent
+				for (size_t col = 0; col + 1 < row.size(); col++)
+					line += (col == 0 ? "" : ",") + row[col];
+				line += "\n";
+				// bound the number of requests in flight so that latency is measured below saturation
+				while (i >= received.load() + window)
+					std::this_thread::yield();
+				sent[i] = Clock::now();
+				for (size_t offset = 0; offset < line.size();) {
+					ssize_t n = ::send(fd, line.data() + offset, line.size() - offset, MSG_NOSIGNAL);
+					if (n <= 0)
+						return;
+					offset += n;
+				}
+			}
+			});
+
+		std::string buffer;
+		char chunk[4096];
+		while (latencies.size() < count) {
+			ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+			if (n <= 0)
+				break;
+			const auto now = Clock::now();
+			for (ssize_t i = 0; i < n; i++) {
+				if (chunk[i] == '\n') {
+					latencies.push_back(std::chrono::duration<double, std::micro>(now - sent[latencies.size()]).count());
+					buffer.clear();
+					received++;
+				}
+				else {
+					buffer.push_back(chunk[i]);
+				}
+			}
+		}
+		sender.join();
+		::close(fd);
+		return latencies;
+	}
+
+	void loadTest(const Arguments& args, const Bagging& model, const Data& rows) {
+		PredictionServer server(model, args.server);
+		std::thread serving([&]() { server.serveUnixSocket(args.socket); });
+
+		std::vector<std::vector<double>> latencies(args.loadTestClients);
+		std::vector<std::thread> clients;
+		const size_t perClient = args.loadTestRequests / args.loadTestClients;
+		const auto start = Clock::now();
+		for (size_t c = 0; c < args.loadTestClients; c++) {
+			clients.emplace_back([&, c]() { latencies[c] = runClient(args.socket, rows, c * perClient, perClient, args.loadTestWindow); });
+		}
+		for (auto& client : clients)
+			client.join();
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		server.stop();
+		serving.join();
+
+		std::vector<double> all;
+		for (const auto& l : latencies)
+			all.insert(all.end(), l.begin(), l.end());
+		std::sort(all.begin(), all.end());
+		auto percentile = [&all](double p) { return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+
+		std::cout << "{\"requests\": " << all.size()
+			<< ", \"clients\": " << args.loadTestClients
+			<< ", \"seconds\": " << seconds
+			<< ", \"requests_per_second\": " << all.size() / seconds
+			<< ", \"client_latency\": {\"p50_us\": " << percentile(0.5) << ", \"p90_us\": " << percentile(0.9)
+			<< ", \"p99_us\": " << percentile(0.99) << ", \"p999_us\": " << percentile(0.999) << "}"
+			<< ", \"server_latency\": " << server.latency().toJson() << "}" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Arguments args;
+	try {
+		args = parseArguments(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		usage();
+		return 2;
+	}
+
+	// training progress goes to stderr, stdout is reserved for the protocol
+	std::streambuf* out = std::cout.rdbuf(std::cerr.rdbuf());
+	std::unique_ptr<DataReader> dr;
+	if (!args.dataset.train.filename.empty())
+		dr = std::make_unique<DataReader>(args.dataset);
+	Bagging model = args.model.empty() ? Bagging(*dr, args.trees, args.seed) : Bagging::load(args.model);
+	// the requests are expected to look like the training rows, their branches guide the layout of the trees
+	if (dr)
+		model.compile(dr->trainData());
+	else
+		model.compile();
+	if (args.cache > 0)
+		model.enableCache(args.cache);
+	std::cout.rdbuf(out);
+
+	if (args.loadTestClients > 0) {
+		loadTest(args, model, dr->testData());
+	}
+	else if (!args.socket.empty()) {
+		// SIGINT and SIGTERM stop the server; they are blocked before the threads of the server are started,
+		// which inherit the mask, and taken by a thread of their own as stop is not async-signal-safe
+		sigset_t signals;
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGINT);
+		sigaddset(&signals, SIGTERM);
+		pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+		PredictionServer server(model, args.server);
+		std::thread stopper([&server, &signals]() {
+			int signal = 0;
+			sigwait(&signals, &signal);
+			server.stop();
+			});
+		std::cerr << "Serving on " << args.socket << std::endl;
+		std::string error;
+		try {
+			server.serveUnixSocket(args.socket);
+		}
+		catch (const std::exception& e) {
+			error = e.what();
+		}
+		// the server stops on its own when it fails, the stopper is still waiting then
+		if (!error.empty())
+			pthread_kill(stopper.native_handle(), SIGTERM);
+		stopper.join();
+		if (!error.empty()) {
+			std::cerr << error << std::endl;
+			return 2;
+		}
+		std::cerr << "Stopped, " << server.latency().toJson() << std::endl;
+	}
+	else {
+		PredictionServer server(model, args.server);
+		server.serveStream(std::cin, std::cout);
+		std::cerr << server.latency().toJson() << std::endl;
+	}
+	if (const PredictionCache* cache = model.predictionCache())
+		std::cerr << cache->toJson() << std::endl;
+	return 0;
+}
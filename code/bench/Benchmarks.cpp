@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Bagging.hpp"
+#include "Boosting.hpp"
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "DecisionTree.hpp"
+#include "SyntheticData.hpp"
+#include "ThreadPool.hpp"
+#include "TreeTest.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * Access to the private parsing and encoding steps of the DataReader.
+ */
+class DataReaderBenchmark {
+public:
+	static void processFile(DataReader& dr, const std::string& filename, Data& data, MetaData& meta) {
+		dr.processFile(filename, data, meta);
+	}
+
+	static void initializeDataInt(DataReader& dr) {
+		dr.InitializeDataInt(*dr.trainData_, dr.trainMetaData_);
+	}
+};
+
+namespace {
+
+	// results of the prediction benchmarks are written here so that the work can not be optimised away
+	volatile size_t checksumSink = 0;
+
+	struct Options {
+		SyntheticSpec spec;
+		std::string directory = ".";
+		int trees = 10;
+		size_t repetitions = 5;
+		std::string filter;
+		bool json = false;
+	};
+
+	// amount of work done by one run of a benchmark, used to report throughput
+	struct Work {
+		double rows = 0;
+		double nodes = 0;
+	};
+
+	struct Result {
+		std::string name;
+		std::vector<double> seconds;
+		Work work;
+
+		double median() const {
+			std::vector<double> sorted = seconds;
+			std::sort(sorted.begin(), sorted.end());
+			return sorted[sorted.size() / 2];
+		}
+		double best() const { return *std::min_element(seconds.begin(), seconds.end()); }
+	};
+
+	void usage() {
+		std::cerr << "Usage: DecisionTreeBench [--rows N] [--test-rows N] [--numeric N] [--categorical N]\n"
+			<< "                         [--cardinality N] [--classes N] [--seed N] [--trees N]\n"
+			<< "                         [--repetitions N] [--filter SUBSTRING] [--dir DIRECTORY] [--json]\n";
+	}
+
+	Options parseArguments(int argc, char* argv[]) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "--json") {
+				options.json = true;
+				continue;
+			}
+			if (i + 1 >= argc)
+				throw std::invalid_argument("Missing value for " + arg);
+			std::string value = argv[++i];
+			if (arg == "--rows") options.spec.rows = std::stoul(value);
+			else if (arg == "--test-rows") options.spec.testRows = std::stoul(value);
+			else if (arg == "--numeric") options.spec.numericColumns = std::stoul(value);
+			else if (arg == "--categorical") options.spec.categoricalColumns = std::stoul(value);
+			else if (arg == "--cardinality") options.spec.cardinality = std::max<size_t>(1, std::stoul(value));
+			else if (arg == "--classes") options.spec.classes = std::max<size_t>(1, std::stoul(value));
+			else if (arg == "--seed") options.spec.seed = std::stoul(value);
+			else if (arg == "--trees") options.trees = std::stoi(value);
+			else if (arg == "--repetitions") options.repetitions = std::max<size_t>(1, std::stoul(value));
+			else if (arg == "--filter") options.filter = value;
+			else if (arg == "--dir") options.directory = value;
+			else throw std::invalid_argument("Unknown argument " + arg);
+		}
+		return options;
+	}
+
+	size_t countNodes(const Node& node) {
+		if (node.leaf() != nullptr)
+			return 1;
+		return 1 + countNodes(*node.trueBranch()) + countNodes(*node.falseBranch());
+	}
+
+	std::vector<VecI*> allRows(const DataInt& data) {
+		std::vector<VecI*> rows;
+		rows.reserve(data.size());
+		for (const auto& row : data)
+			rows.push_back(const_cast<VecI*>(&row));
+		return rows;
+	}
+
+	class Runner {
+	public:
+		explicit Runner(const Options& options) : options_(options), results_({}) {}
+
+		// time `repetitions` runs of the benchmark
+		void run(const std::string& name, const std::function<Work()>& benchmark) {
+			if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos)
+				return;
+			Result result{ name, {}, {} };
+			for (size_t i = 0; i < options_.repetitions; i++) {
+				const auto start = Clock::now();
+				result.work = benchmark();
+				result.seconds.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+			}
+			results_.push_back(result);
+		}
+
+		void report(std::ostream& out) const {
+			if (options_.json) {
+				out << "[";
+				for (size_t i = 0; i < results_.size(); i++) {
+					const auto& r = results_[i];
+					out << (i == 0 ? "\n" : ",\n") << "  {\"name\": \"" << r.name << "\""
+						<< ", \"median_s\": " << r.median()
+						<< ", \"best_s\": " << r.best()
+						<< ", \"rows_per_s\": " << r.work.rows / r.median()
+						<< ", \"nodes_per_s\": " << r.work.nodes / r.median() << "}";
+				}
+				out << "\n]" << std::endl;
+				return;
+			}
+			out << std::left << std::setw(44) << "benchmark" << std::right
+				<< std::setw(12) << "median ms" << std::setw(12) << "best ms"
+				<< std::setw(16) << "rows/s" << std::setw(16) << "nodes/s" << "\n";
+			for (const auto& r : results_) {
+				out << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(3)
+					<< std::setw(12) << r.median() * 1000 << std::setw(12) << r.best() * 1000 << std::setprecision(0)
+					<< std::setw(16) << (r.work.rows > 0 ? r.work.rows / r.median() : 0)
+					<< std::setw(16) << (r.work.nodes > 0 ? r.work.nodes / r.median() : 0) << "\n";
+			}
+			out << std::flush;
+		}
+
+	private:
+		const Options& options_;
+		std::vector<Result> results_;
+	};
+}
+
+int main(int argc, char* argv[]) {
+	Options options;
+	try {
+		options = parseArguments(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		usage();
+		return 2;
+	}
+
+	// the library reports progress on std::cout, keep it out of the results
+	std::ostream out(std::cout.rdbuf());
+	std::ostringstream sink;
+	std::cout.rdbuf(sink.rdbuf());
+
+	const Dataset dataset = Synthetic::writeDataset(options.directory, options.spec);
+	DataReader dr(dataset);
+	const MetaData& meta = dr.metaData();
+	const double rows = static_cast<double>(dr.trainDataInt().size());
+	const double testRows = static_cast<double>(dr.testData().size());
+	const std::vector<VecI*> root = allRows(dr.trainDataInt());
+	Runner runner(options);
+
+	// reader
+	runner.run("reader/processFile", [&]() {
+		Data data;
+		MetaData fileMeta;
+		DataReaderBenchmark::processFile(dr, dataset.train.filename, data, fileMeta);
+		return Work{ static_cast<double>(data.size()), 0 };
+		});
+	// encode into a copy, the kernel benchmarks below point into the rows of dr
+	DataReader encoder = dr;
+	runner.run("reader/InitializeDataInt", [&]() {
+		DataReaderBenchmark::initializeDataInt(encoder);
+		return Work{ rows, 0 };
+		});
+	runner.run("reader/DataReader", [&]() {
+		DataReader reader(dataset);
+		return Work{ static_cast<double>(reader.trainData().size() + reader.testData().size()), 0 };
+		});
+
+	// split kernels on the root node, the first column of every kind
+	const ClassCounterInt decisionCounts = Calculations::classCounts(root);
+	const double decisionGini = Calculations::gini(decisionCounts, root.size());
+	for (size_t col = 0; col + 1 < meta.labels.size(); col++) {
+		const bool isnumeric = meta.isnumeric[col];
+		if (col != 0 && col != options.spec.numericColumns)
+			continue;
+		const std::string kind = isnumeric ? "numeric" : "categorical";
+		runner.run("split/determine_best_threshold/" + kind, [&, col, isnumeric]() {
+			Calculations::determine_best_threshold(root, col, isnumeric, decisionCounts, decisionGini);
+			return Work{ rows, 0 };
+			});
+		const Question question(col, isnumeric ? std::to_string(options.spec.numericRange / 2) : meta.mapI2S[col].at(0));
+		runner.run("partition/" + kind, [&, question]() {
+			Calculations::partition(root, question, meta);
+			return Work{ rows, 0 };
+			});
+	}
+	runner.run("split/find_best_split", [&]() {
+		Calculations::find_best_split(root, meta);
+		return Work{ rows, 0 };
+		});
+
+	// training
+	DataInt bootstrap = dr.trainDataInt();
+	size_t treeNodes = 0;
+	runner.run("build/buildTree", [&]() {
+		DecisionTree tree(dr, bootstrap);
+		treeNodes = countNodes(tree.root_);
+		return Work{ rows, static_cast<double>(treeNodes) };
+		});
+	runner.run("build/Bagging", [&]() {
+		Bagging bagging(dr, options.trees, options.spec.seed);
+		return Work{ rows * options.trees, 0 };
+		});
+	// shallow boosted trees, one per class and round
+	BoostingOptions boostingOptions;
+	boostingOptions.rounds = options.trees;
+	runner.run("build/Boosting", [&]() {
+		Boosting boosting(dr, boostingOptions);
+		return Work{ rows * boosting.size(), 0 };
+		});
+
+	// inference
+	DecisionTree tree(dr, bootstrap);
+	const Data& testData = dr.testData();
+	runner.run("predict/TreeTest::classify", [&]() {
+		TreeTest t;
+		size_t checksum = 0;
+		for (const auto& row : testData)
+			checksum += t.classify(row, tree.root_).prediction();
+		checksumSink = checksum;
+		return Work{ testRows, 0 };
+		});
+	Bagging bagging(dr, options.trees, options.spec.seed);
+	ThreadPool pool(ThreadPool::defaultThreads());
+	runner.run("predict/Bagging", [&]() {
+		bagging.predict(testData, pool);
+		return Work{ testRows, 0 };
+		});
+	bagging.compile(dr.trainData());
+	runner.run("predict/Bagging/compiled", [&]() {
+		bagging.predict(testData, pool);
+		return Work{ testRows, 0 };
+		});
+	Boosting boosting(dr, boostingOptions);
+	runner.run("predict/Boosting", [&]() {
+		boosting.predict(testData, pool);
+		return Work{ testRows, 0 };
+		});
+
+	std::cout.rdbuf(out.rdbuf());
+	runner.report(std::cout);
+	return 0;
+}
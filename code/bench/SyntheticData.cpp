@@ -0,0 +1,65 @@
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "SyntheticData.hpp"
+
+void Synthetic::writeArff(const std::string& filename, const SyntheticSpec& spec, size_t rows, unsigned seed) {
+	std::ofstream file(filename);
+	if (!file)
+		throw std::runtime_error("Can't write file: " + filename);
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<int> numeric(0, spec.numericRange - 1);
+	std::uniform_int_distribution<size_t> category(0, spec.cardinality - 1);
+	std::uniform_int_distribution<size_t> randomClass(0, spec.classes - 1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	file << "@RELATION synthetic\n\n";
+	for (size_t col = 0; col < spec.numericColumns; col++)
+		file << "@ATTRIBUTE num" << col << " NUMERIC\n";
+	for (size_t col = 0; col < spec.categoricalColumns; col++) {
+		file << "@ATTRIBUTE cat" << col << " {";
+		for (size_t value = 0; value < spec.cardinality; value++)
+			file << (value == 0 ? "" : ", ") << "v" << value;
+		file << "}\n";
+	}
+	file << "@ATTRIBUTE class {";
+	for (size_t c = 0; c < spec.classes; c++)
+		file << (c == 0 ? "" : ", ") << "class" << c;
+	file << "}\n\n@DATA\n";
+
+	std::vector<int> numbers(spec.numericColumns);
+	std::vector<size_t> categories(spec.categoricalColumns);
+	for (size_t row = 0; row < rows; row++) {
+		for (auto& n : numbers)
+			n = numeric(rng);
+		for (auto& c : categories)
+			c = category(rng);
+
+		// the class depends on the first two numeric and the first categorical attributes
+		size_t score = 0;
+		if (!numbers.empty())
+			score += numbers[0] * 2 / spec.numericRange;
+		if (numbers.size() > 1)
+			score += numbers[1] > spec.numericRange / 3 ? 1 : 0;
+		if (!categories.empty())
+			score += categories[0] % 3;
+		size_t cls = uniform(rng) < spec.noise ? randomClass(rng) : score % spec.classes;
+
+		for (int n : numbers)
+			file << n << ",";
+		for (size_t c : categories)
+			file << "v" << c << ",";
+		file << "class" << cls << "\n";
+	}
+}
+
+Dataset Synthetic::writeDataset(const std::string& directory, const SyntheticSpec& spec) {
+	Dataset dataset;
+	dataset.train.filename = directory + "/synthetic_train.arff";
+	dataset.test.filename = directory + "/synthetic_test.arff";
+	dataset.classLabel = "class";
+	writeArff(dataset.train.filename, spec, spec.rows, spec.seed);
+	writeArff(dataset.test.filename, spec, spec.testRows, spec.seed + 1);
+	return dataset;
+}
@@ -0,0 +1,38 @@
+#ifndef DECISIONTREE_SYNTHETICDATA_HPP
+#define DECISIONTREE_SYNTHETICDATA_HPP
+
+#include <string>
+#include "Dataset.hpp"
+
+/**
+ * Shape of a generated data set.
+ *
+ * The class of a row is a noisy function of a few numeric and categorical
+ * attributes, so that the trees learned on it have a realistic depth.
+ */
+struct SyntheticSpec {
+	size_t rows = 100000;
+	size_t testRows = 10000;
+	size_t numericColumns = 8;
+	size_t categoricalColumns = 8;
+	// number of distinct values of every categorical column
+	size_t cardinality = 10;
+	size_t classes = 2;
+	// numeric values are drawn uniformly from [0, numericRange)
+	int numericRange = 1000;
+	// fraction of rows whose class is drawn at random
+	double noise = 0.1;
+	unsigned seed = 42;
+};
+
+namespace Synthetic {
+
+	// write an ARFF file with the given number of rows, the class column is called "class" and is last
+	void writeArff(const std::string& filename, const SyntheticSpec& spec, size_t rows, unsigned seed);
+
+	// write a train and a test file in the directory and return the matching data set
+	Dataset writeDataset(const std::string& directory, const SyntheticSpec& spec);
+
+} // namespace Synthetic
+
+#endif //DECISIONTREE_SYNTHETICDATA_HPP
@@ -1,30 +1,210 @@
 #ifndef DECISIONTREE_BAGGING_HPP
 #define DECISIONTREE_BAGGING_HPP
 
+#include <memory>
 #include <random>
-#include <boost/chrono.hpp>
 #include "Dataset.hpp"
 #include "DecisionTree.hpp"
 #include "Calculations.hpp"
+#include "Compaction.hpp"
 #include "DataReader.hpp"
+#include "FlatTree.hpp"
+#include "Memory.hpp"
+#include "Metrics.hpp"
+#include "PredictionCache.hpp"
+#include "Pruning.hpp"
+#include "ThreadPool.hpp"
 #include "TreeTest.hpp"
+#include "Validation.hpp"
+
+/**
+ * Stops the growth of an ensemble once its validation signal stopped improving.
+ */
+struct EarlyStopping {
+    enum Metric { Accuracy, LogLoss };
+
+    // trees added without improvement before the training stops, 0 trains every tree
+    size_t patience = 0;
+    Metric metric = LogLoss;
+    // smallest increase of the accuracy, or decrease of the log-loss, counted as an improvement
+    double minDelta = 1e-4;
+    // labelled rows scored after every tree, the out-of-bag rows of every tree are scored when null
+    const Data* holdout = nullptr;
+};
+
+/**
+ * Training parameters of a Bagging ensemble.
+ */
+struct BaggingOptions {
+    int ensembleSize = 10;
+    uint seed = 1234;
+    // bytes the training may account for at once (data set, bootstrap samples, trees and
+    // transient row partitions), training throws MemoryBudgetExceeded beyond it; 0 is unlimited
+    size_t memoryBudget = 0;
+    // number of trees built concurrently, the ensemble does not depend on it
+    size_t threads = ThreadPool::defaultThreads();
+    // the trees after the best validation signal are dropped, the ensemble does not depend on the threads
+    EarlyStopping earlyStopping{};
+    // wall clock seconds the building of the trees may take, 0 is unlimited. With a budget ensembleSize is the
+    // largest number of trees: a tree is only started when the mean build time of the trees built so far
+    // fits in the time left, and a tree exceeding the memory budget ends the training instead of failing it.
+    // The trees built are kept, at least one; see timeBudgetReport. The limit is soft: a tree is never
+    // interrupted, so the trees in flight, and the first wave, can run past the budget
+    double timeBudget = 0;
+    // growth limits and split search of every tree, unpruned trees with the best splits by default
+    TreeOptions tree{};
+};
 
 class Bagging {
   public:
     Bagging() = delete;
     explicit Bagging(const DataReader& dr, const int ensembleSize, uint seed = 1234);
+    Bagging(const DataReader& dr, const BaggingOptions& options);
+    // an ensemble of trees trained elsewhere on dr with the options, see trainSlice
+    Bagging(const DataReader& dr, const BaggingOptions& options, std::vector<Node> learners);
 
     void test() const;
+    // fraction of the rows whose last column holds the predicted class
+    double accuracy(const Data& rows, ThreadPool& pool) const;
+
+    // predict the class label of one row by majority vote over all learners
+    std::string predict(const VecS& row) const;
+    // class id of the majority vote, see MetaData::classNames
+    uint32_t predictClass(const VecS& row) const;
+    // predict a batch of rows, spreading the rows over the threads of the pool
+    VecS predict(const Data& rows, ThreadPool& pool) const;
+
+    // lay the trees out in contiguous arrays for inference, see FlatTree; the predictions do not change.
+    // With a sample the layout follows the branches the sample rows take. grow drops the compiled trees
+    void compile();
+    void compile(const Data& sample);
+    inline bool compiled() const { return !compiled_.empty(); }
+
+    // keep the predictions of up to capacity distinct rows, see PredictionCache; copies of the ensemble
+    // share the cache, and the entries predicted before the ensemble changes are never returned after
+    void enableCache(size_t capacity);
+    void disableCache();
+    // null when the cache is disabled
+    inline const PredictionCache* predictionCache() const { return cache_.get(); }
 
-    inline Data testData() { return dr_.testData(); }
+    // rewrite every tree into its subtree of minimal cost-complexity for alpha, see Pruning; alpha is
+    // a training error rate per leaf, the smallest subtree that keeps the training error within it
+    void prune(double alpha);
+    // reduced-error pruning of every tree on labelled rows held out of the training
+    void prune(const Data& validation);
+    // node count and accuracy of the ensemble on the validation rows when its trees are pruned with
+    // points values of alpha, spread over the alpha paths of the trees from the full trees to stumps
+    std::vector<PruningStep> pruningPath(const Data& validation, size_t points = 10) const;
+
+    // share the identical subtrees of all the trees, see Compaction; the predictions do not change and the tree
+    // bytes of the memory report count every shared object once. The sharing only lives in memory: save writes
+    // every tree in full and compile lays out every tree on its own
+    CompactionReport compact();
+
+    // warm start: train options.ensembleSize additional trees on a new or combined data set and keep the
+    // trees already built; with a window the oldest trees are dropped until at most window trees are left.
+    // The new trees continue the seed sequence of the ensemble, options.seed is not used.
+    // The data set must have the columns of the ensemble, new category values and classes are merged into
+    // the meta data. Returns the number of trees added, counted before the window drops any; early stopping
+    // and a time budget can keep fewer trees than options.ensembleSize
+    size_t grow(const DataReader& dr, const BaggingOptions& options, size_t window = 0);
+
+    // trains the trees [begin, end) of the ensemble described by the options and writes them to out, the
+    // trees are those a single Bagging with the same options would build, whatever process builds them
+    static void trainSlice(const DataReader& dr, const BaggingOptions& options, size_t begin, size_t end, std::ostream& out);
+    // reads a slice written by trainSlice, returns the index of its first tree and its trees
+    static std::pair<size_t, std::vector<Node>> readSlice(std::istream& in);
+
+    // write the meta data and the trees of the ensemble to a file
+    void save(const std::string& filename) const;
+    // read an ensemble written by save, it can predict but holds no data set
+    static Bagging load(const std::string& filename);
+
+    Data testData() const;
+    inline const MetaData& metaData() const { return meta_; }
+    inline size_t size() const { return learners_.size(); }
+    // the trees of the ensemble, the oldest first
+    inline const std::vector<Node>& trees() const { return learners_; }
+    inline uint seed() const { return seed_; }
+    // seeds drawn for the trees of the ensemble, at least size() as the trees dropped by a window count too
+    inline size_t seedsDrawn() const { return seedsDrawn_; }
+    // nodes of all the trees, leaves included
+    size_t nodeCount() const;
+
+    // timings and tree statistics of the training, including loading and encoding the data set
+    inline const TrainingMetrics& trainingMetrics() const { return trainingMetrics_; }
+    // node visits of all predictions made so far
+    inline const InferenceMetrics& inferenceMetrics() const { return inferenceMetrics_; }
+    // bytes held by the data set, the bootstrap samples and the trees during the training
+    inline const MemoryReport& memoryReport() const { return memoryReport_; }
+    // validation signal of every tree and number of trees kept, when early stopping is enabled
+    inline const EarlyStoppingReport& earlyStoppingReport() const { return earlyStoppingReport_; }
+    // trees built and their build times, when the training had a time budget
+    inline const TimeBudgetReport& timeBudgetReport() const { return timeBudgetReport_; }
 
   private:
-    DataReader dr_;
+    // a tree built on one bootstrap sample, with its statistics
+    struct Learner {
+        Node root{};
+        TreeMetrics metrics{};
+        size_t bootstrapBytes = 0;
+        size_t treeBytes = 0;
+        size_t peakTransientBytes = 0;
+        // rows drawn in the bootstrap sample, the other rows are out-of-bag
+        std::vector<bool> inBag{};
+    };
+
+    // the data set the ensemble was trained on, null for a loaded ensemble
+    std::shared_ptr<const DataReader> dr_;
+    MetaData meta_;
     int ensembleSize_;
-    std::vector<DecisionTree> learners_;
+    size_t memoryBudget_;
+    size_t threads_;
+    EarlyStopping earlyStopping_;
+    double timeBudget_;
+    TreeOptions treeOptions_;
+    std::vector<Node> learners_;
+    // the learners compiled for inference, empty until compile is called
+    std::vector<FlatTree> compiled_;
+    // changes whenever the trees change, the cached predictions are tagged with it
+    uint64_t version_;
+    std::shared_ptr<PredictionCache> cache_;
+    // the columns the trees ask about, the key of a cached prediction
+    std::vector<int> cacheColumns_;
     std::mt19937_64 random_number_generator;
+    // seed of the ensemble and number of seeds drawn from it so far, trees dropped by a window included, so that
+    // new trees never reuse the seed of an earlier tree; both are saved with the model
+    uint seed_;
+    size_t seedsDrawn_;
+    TrainingMetrics trainingMetrics_;
+    mutable InferenceMetrics inferenceMetrics_;
+    MemoryReport memoryReport_;
+    EarlyStoppingReport earlyStoppingReport_;
+    TimeBudgetReport timeBudgetReport_;
+
+    Bagging(MetaData meta, std::vector<Node> learners);
 
-    void buildBag();
+    // trains the trees on dr_, the class ids of their leaves are translated with classIds unless it is empty
+    void buildBag(int trees, const std::vector<uint32_t>& classIds);
+    // builds the trees in waves of threads_ trees and scores them in the order of their seeds, until the
+    // signal did not improve for the patience; returns the trees up to the best signal, their class ids
+    // translated with classIds unless it is empty
+    std::vector<Learner> buildWithEarlyStopping(const std::vector<uint64_t>& seeds, const std::vector<uint32_t>& classIds, MemoryTracker& memory);
+    // starts the trees of the seeds on the threads while they are expected to finish within the time budget,
+    // returns the trees built in the order of their seeds
+    std::vector<Learner> buildWithinBudget(const std::vector<uint64_t>& seeds, MemoryTracker& memory);
+    // builds the trees of the seeds on a pool of threads, in the order of the seeds
+    static std::vector<Learner> buildLearners(const DataReader& dr, const TreeOptions& options, const std::vector<uint64_t>& seeds, size_t threads, MemoryTracker& memory);
+    static Learner buildLearner(const DataReader& dr, const TreeOptions& options, uint64_t seed, MemoryTracker& memory);
+    // the seed of every tree is drawn up front, so that the ensemble does not depend on how the trees are scheduled
+    static std::vector<uint64_t> drawSeeds(std::mt19937_64& generator, size_t count);
+    // adds the categories and classes of other to the meta data, returns the class id in meta_ of every class of other
+    std::vector<uint32_t> mergeMetaData(const MetaData& other);
+    static Node translateClasses(const Node& root, const std::vector<uint32_t>& classIds, size_t classes);
+    // replaces the trees by their pruned trees, which drops the compiled trees and the cached predictions
+    void replaceLearners(std::vector<Node> learners);
+    // majority vote of the trees, on the encoded row when it is given and the trees are compiled
+    uint32_t vote(const VecS& row, const FlatRow* encoded) const;
 };
 
 #endif //DECISIONTREE_BAGGING_HPP
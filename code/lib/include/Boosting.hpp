@@ -0,0 +1,95 @@
+#ifndef DECISIONTREE_BOOSTING_HPP
+#define DECISIONTREE_BOOSTING_HPP
+
+#include <memory>
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "Metrics.hpp"
+#include "Node.hpp"
+#include "ThreadPool.hpp"
+#include "TreeTest.hpp"
+#include "Utils.hpp"
+
+/**
+ * Training parameters of a Boosting ensemble.
+ */
+struct BoostingOptions {
+    // every round fits one regression tree per class
+    int rounds = 100;
+    // shrinkage applied to the leaf values of every tree
+    double learningRate = 0.1;
+    // depth limit of the trees, the root is at depth 0
+    size_t maxDepth = 4;
+    // L2 regularisation of the leaf values
+    double lambda = 1.0;
+    // minimum sum of hessians on each side of a split
+    double minChildWeight = 1.0;
+    // number of class trees of a round built concurrently, the ensemble does not depend on it
+    size_t threads = ThreadPool::defaultThreads();
+};
+
+/**
+ * Gradient boosted trees for multiclass classification.
+ *
+ * Every round fits one shallow CART regression tree per class on the gradient
+ * and hessian of the softmax log-loss of the current scores. The split search
+ * maximises the loss reduction over gradient/hessian sums instead of the Gini
+ * gain, and the leaves hold -G / (H + lambda) scaled by the learning rate. The
+ * row partitioning and the tree structure are shared with DecisionTree.
+ */
+class Boosting {
+  public:
+    Boosting() = delete;
+    Boosting(const DataReader& dr, const BoostingOptions& options);
+
+    // prints the accuracy on the test data
+    void test(const Data& testData) const;
+    // fraction of the rows whose last column holds the predicted class
+    double accuracy(const Data& rows, ThreadPool& pool) const;
+
+    // raw score of every class, indexed by class id
+    std::vector<double> scores(const VecS& row) const;
+    // softmax of the scores
+    std::vector<double> probabilities(const VecS& row) const;
+    // class id with the highest score, see MetaData::classNames
+    uint32_t predictClass(const VecS& row) const;
+    std::string predict(const VecS& row) const;
+    // predict a batch of rows, spreading the rows over the threads of the pool
+    VecS predict(const Data& rows, ThreadPool& pool) const;
+
+    inline const MetaData& metaData() const { return meta_; }
+    // number of trees, rounds times classes
+    inline size_t size() const { return trees_.size(); }
+    // training log-loss after every round
+    inline const std::vector<double>& trainingLoss() const { return trainingLoss_; }
+    inline const TrainingMetrics& trainingMetrics() const { return trainingMetrics_; }
+    inline const InferenceMetrics& inferenceMetrics() const { return inferenceMetrics_; }
+
+  private:
+    // state shared by all the nodes of a tree under construction
+    struct BuildContext {
+        const MetaData& meta;
+        const DataInt& data;
+        const Gradients& gradients;
+        const BoostingOptions& options;
+        // the leaf values are added to the score of their rows at index row * classes + klass
+        std::vector<double>& scores;
+        size_t klass;
+        TreeMetrics* metrics;
+    };
+
+    MetaData meta_;
+    BoostingOptions options_;
+    // initial score of every class, the log of its prior
+    std::vector<double> baseScores_;
+    // the trees of round r are at r * classes .. r * classes + classes - 1, one per class id
+    std::vector<Node> trees_;
+    std::vector<double> trainingLoss_;
+    TrainingMetrics trainingMetrics_;
+    mutable InferenceMetrics inferenceMetrics_;
+
+    void boost(const DataInt& data);
+    static Node buildTree(const BuildContext& context, const std::vector<VecI*>& VecPtrVecI, size_t depth);
+};
+
+#endif //DECISIONTREE_BOOSTING_HPP
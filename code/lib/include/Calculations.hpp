@@ -1,6 +1,7 @@
 #ifndef DECISIONTREE_CALCULATIONS_HPP
 #define DECISIONTREE_CALCULATIONS_HPP
 
+#include <cstdint>
 #include <tuple>
 #include <vector>
 #include <string>
@@ -14,11 +15,21 @@ using ClassCounter = std::unordered_map<std::string, int>;
 // new type of class counter adapted to a dataset transformed in int
 using ClassCounterInt = std::unordered_map<int, int>;
 
+// gradient and hessian of the loss of one training row with respect to its score
+struct GradientPair {
+	double grad = 0;
+	double hess = 0;
+};
+
+// gradients of the training rows, indexed by the position of the row in the DataInt table
+using Gradients = std::vector<GradientPair>;
+
 namespace Calculations {
 
 	std::tuple<const Data, const Data> partition(const Data& data, const Question& q);
 
-	std::tuple<std::vector<VecI*>, std::vector<VecI*>> partition(const std::vector<VecI*> VecPtrVecI, const Question& q, const MetaData& meta);
+	// with threads > 1 the rows are split in that many contiguous chunks processed concurrently, the result is the same
+	std::tuple<std::vector<VecI*>, std::vector<VecI*>> partition(const std::vector<VecI*>& VecPtrVecI, const Question& q, const MetaData& meta, size_t threads = 1);
 
 	const double gini(const ClassCounter& counts, double N);
 
@@ -26,7 +37,12 @@ namespace Calculations {
 
 	std::tuple<const double, const Question> find_best_split(const Data& rows, const MetaData& meta);
 
-	std::tuple<const double, const Question> find_best_split(const std::vector<VecI*> VecPtrVecI, const MetaData& meta);
+	// with threads > 1 the class counts, the gathering and the sort of every column are split over the rows
+	std::tuple<const double, const Question> find_best_split(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, size_t threads = 1);
+
+	// Extra-Trees split: every column gets one question drawn from the seed, a threshold between the lowest and the
+	// highest value of the node or one of the categories of the node, and the question with the highest gain is kept
+	std::tuple<const double, const Question> find_random_split(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, uint64_t seed, size_t threads = 1);
 
 	std::tuple<std::string, double> determine_best_threshold_numeric(const Data& data, int col);
 
@@ -36,6 +52,16 @@ namespace Calculations {
 
 	const ClassCounterInt classCounts(const std::vector<VecI*> VecPtrVecI);
 
+	// split search of the regression trees fitted by Boosting: the gain is the decrease of the second order
+	// approximation of the loss, 1/2 (G_t^2 / (H_t + lambda) + G_f^2 / (H_f + lambda) - G^2 / (H + lambda)),
+	// and splits leaving less than minChildWeight hessian on one side are skipped
+	std::tuple<const double, const Question> find_best_split(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, const DataInt& data, const Gradients& gradients, double lambda, double minChildWeight);
+
+	std::tuple<std::string, double> determine_best_threshold(const std::vector<VecI*>& VecPtrVecI, int col, bool isnumeric, const DataInt& data, const Gradients& gradients, const GradientPair& total, double lambda, double minChildWeight);
+
+	// sums of the gradients and hessians of the rows
+	const GradientPair gradientSum(const std::vector<VecI*>& VecPtrVecI, const DataInt& data, const Gradients& gradients);
+
 	const ClassCounter classCounts(const Data& data);
 
 
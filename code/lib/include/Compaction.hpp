@@ -0,0 +1,44 @@
+#ifndef DECISIONTREE_COMPACTION_HPP
+#define DECISIONTREE_COMPACTION_HPP
+
+#include <string>
+#include <vector>
+#include "Node.hpp"
+
+/**
+ * Result of the deduplication of the subtrees of an ensemble.
+ */
+struct CompactionReport {
+	size_t trees = 0;
+	// nodes of all the trees, leaves included, as if no subtree were shared
+	size_t nodes = 0;
+	// Node and Leaf objects of the shared representation, every root is an object of its own
+	size_t distinctNodes = 0;
+	size_t distinctLeaves = 0;
+	// bytes of the distinct node and leaf objects of the ensemble, before and after
+	size_t bytesBefore = 0;
+	size_t bytesAfter = 0;
+
+	// nodes per Node object
+	inline double ratio() const { return distinctNodes > 0 ? static_cast<double>(nodes) / distinctNodes : 1.0; }
+	std::string toJson() const;
+};
+
+/**
+ * Hash-consing of the trees of an ensemble into a directed acyclic graph.
+ *
+ * Two subtrees are identical when they ask the same question and have
+ * identical branches, two leaves when they hold the same class counts.
+ * The trees are rewritten bottom up so that all the copies of a subtree,
+ * within a tree or across trees, are the same Node and Leaf objects, linked
+ * by every parent; only the roots, held by value, are copies. The predictions
+ * do not change. The sharing is in memory only: Serialization writes, and
+ * FlatTree lays out, every tree in full.
+ */
+namespace Compaction {
+
+	CompactionReport compact(std::vector<Node>& roots);
+
+} // namespace Compaction
+
+#endif //DECISIONTREE_COMPACTION_HPP
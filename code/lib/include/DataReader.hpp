@@ -10,9 +10,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include <boost/algorithm/string.hpp>
 #include "Dataset.hpp"
+#include "Memory.hpp"
+#include "Metrics.hpp"
 #include "Utils.hpp"
 
 /**
@@ -32,13 +35,23 @@ public:
 	DataReader() = delete;
 	DataReader(const Dataset& d);
 
-	inline const Data& trainData() const { return trainData_; }
-	inline const Data& testData() const { return testData_; }
+	inline const Data& trainData() const { return *trainData_; }
+	inline const Data& testData() const { return *testData_; }
 	inline const MetaData& metaData() const { return trainMetaData_; }
 
 	// function to retrieve the table containing the trainData information in int format
-	inline const DataInt& trainDataInt() const { return trainDataInt_; }
+	inline const DataInt& trainDataInt() const { return *trainDataInt_; }
+	// false when the string table of the training data was dropped after encoding, see Dataset::keepTrainStrings
+	inline bool hasTrainStrings() const { return !trainData_->empty(); }
+
+	// time spent loading and encoding the data set
+	inline const PhaseTimes& metrics() const { return metrics_; }
+	// bytes held by the string and int tables
+	DataMemory memoryUsage() const;
 private:
+	// gives the benchmarks access to the individual parsing and encoding steps
+	friend class DataReaderBenchmark;
+
 	void processFile(const std::string& strings, Data& data, MetaData& meta);
 	void moveClassDataToBack(VecS& line, const VecS& labels) const;
 	void moveClassLabelToBack();
@@ -47,16 +60,19 @@ private:
 	bool parseHeaderLine(const std::string& line, MetaData& meta, bool& header_loaded);
 	bool parseDataLine(const std::string& line, Data& data, MetaData& meta);
 	// function to transform the original Data table to DataInt in the trainDataInt_
-	void InitializeDataInt(Data& data, const MetaData& meta);
+	void InitializeDataInt(const Data& data, const MetaData& meta);
  
 
 	const std::string classLabel_;
-	Data trainData_;
-	Data testData_;
+	// the tables are not modified once the reader is built: copies of a reader, like the one an
+	// ensemble keeps, share them instead of copying the rows
+	std::shared_ptr<const Data> trainData_;
+	std::shared_ptr<const Data> testData_;
 	MetaData trainMetaData_;
 	MetaData testMetaData_;
 	// Table containing the trainData information in int format
-	DataInt trainDataInt_;
+	std::shared_ptr<const DataInt> trainDataInt_;
+	PhaseTimes metrics_;
 };
 
 #endif //DECISIONTREE_ARFFREADER_HPP
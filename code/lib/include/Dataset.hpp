@@ -26,6 +26,8 @@ struct Dataset {
 	Train train;
 	Test test;
 	std::string classLabel;
+	// false drops the string table of the training data once it is encoded, trainData() is then empty
+	bool keepTrainStrings = true;
 };
 
 #endif //DECISIONTREE_DATASET_HPP
@@ -3,20 +3,46 @@
 
 #include "Calculations.hpp"
 #include "DataReader.hpp"
+#include "Memory.hpp"
+#include "Metrics.hpp"
 #include "Node.hpp"
+#include "ThreadPool.hpp"
 #include "TreeTest.hpp"
 #include "Utils.hpp"
 
+/**
+ * Limits of the growth of a tree, by default trees are grown until their leaves are pure.
+ */
+struct TreeOptions {
+	// nodes at this depth become leaves, the root is at depth 0; 0 is unlimited
+	size_t maxDepth = 0;
+	// nodes with fewer rows become leaves
+	size_t minRowsSplit = 2;
+	// nodes with at least this many rows split their statistics and partition over rowThreads threads; 0 never does
+	size_t parallelRows = 200000;
+	size_t rowThreads = ThreadPool::defaultThreads();
+	// Extra-Trees: every node draws one random question per column and keeps the best of them, instead of
+	// searching the best threshold of every column; see Calculations::find_random_split
+	bool extraTrees = false;
+	// seed of the random questions, every node derives its own from it and its position in the tree,
+	// so that the tree does not depend on the threads building it. Bagging draws one per tree
+	uint64_t seed = 0;
+};
+
 class DecisionTree {
 public:
 	DecisionTree() = delete;
 	explicit DecisionTree(const DataReader& dr);
-	explicit DecisionTree(DataReader& dr, DataInt& bootstrap_int);
+	// the transient row partitions are accounted on the memory tracker when one is given
+	explicit DecisionTree(const DataReader& dr, const DataInt& bootstrap_int, MemoryTracker* memory = nullptr, const TreeOptions& options = TreeOptions());
+	// tree on a view of rows owned by someone else, for example a fold of the training data
+	DecisionTree(const DataReader& dr, const std::vector<VecI*>& rows, const TreeOptions& options, MemoryTracker* memory = nullptr);
 	void print() const;
 	void test() const;
 
 	inline Data testData() { return dr_.testData(); }
 	inline std::shared_ptr<Node> root() { return std::make_shared<Node>(root_); }
+	inline const TreeMetrics& metrics() const { return metrics_; }
 
 	Node root_;
 
@@ -25,7 +51,17 @@ private:
 	// 	   It was  consuming a lot of memory especially for the bagging
 	//DataReader dr_;
 	const DataReader& dr_;
-	static Node buildTree(const MetaData& meta, const std::vector<std::vector<int>*> VecPtrVecI);
+	TreeMetrics metrics_;
+
+	// state shared by all the nodes of a tree under construction
+	struct BuildContext {
+		const MetaData& meta;
+		const TreeOptions& options;
+		TreeMetrics* metrics;
+		MemoryTracker* memory; // null when memory is not accounted
+	};
+	// seed is the seed of the random questions of the node with Extra-Trees
+	static Node buildTree(const BuildContext& context, const std::vector<std::vector<int>*>& VecPtrVecI, size_t depth, uint64_t seed);
 
 	//const Node buildTree(const Data& rows, const MetaData &meta);
 	void print(const std::shared_ptr<Node> root, std::string spacing = "") const;
@@ -0,0 +1,37 @@
+#ifndef DECISIONTREE_DISTRIBUTED_HPP
+#define DECISIONTREE_DISTRIBUTED_HPP
+
+#include <istream>
+#include <utility>
+#include <vector>
+#include "Bagging.hpp"
+#include "DataReader.hpp"
+
+/**
+ * Training of a Bagging ensemble by several worker processes.
+ *
+ * The ensemble is split in contiguous slices of trees. A worker trains its
+ * slice with Bagging::trainSlice and returns the serialized trees, which the
+ * coordinator merges in slice order. As every tree is built from the seed a
+ * single process would draw for it, the merged ensemble is identical to the
+ * one of a single process with the same options.
+ *
+ * On one host the workers are forked from the coordinator after it loaded the
+ * data set, so they share its pages copy-on-write and report over pipes. Other
+ * hosts can run `DecisionTreeCli worker` on the same data set and hand their
+ * output to merge.
+ */
+namespace Distributed {
+
+	// the slices [begin, end) of the trees, as equal as possible, for the workers
+	std::vector<std::pair<size_t, size_t>> slices(size_t trees, size_t workers);
+
+	// trains the ensemble with workers local processes, each using options.threads / workers threads
+	Bagging train(const DataReader& dr, const BaggingOptions& options, size_t workers);
+
+	// merges the slices written by the workers, they have to cover every tree of the ensemble once
+	Bagging merge(const DataReader& dr, const BaggingOptions& options, const std::vector<std::istream*>& slices);
+
+} // namespace Distributed
+
+#endif //DECISIONTREE_DISTRIBUTED_HPP
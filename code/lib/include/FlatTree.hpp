@@ -0,0 +1,83 @@
+#ifndef DECISIONTREE_FLATTREE_HPP
+#define DECISIONTREE_FLATTREE_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Node.hpp"
+#include "Utils.hpp"
+
+/**
+ * A row prepared once for all the flat trees that score it.
+ *
+ * Question::solve parses the value of the row and the value of the question
+ * at every node. Here every value is parsed once: numbers holds the values
+ * that parse as a number (NaN for the others) and categories the category
+ * id of the values of the categorical columns (-1 when unknown).
+ */
+struct FlatRow {
+	std::vector<double> numbers{};
+	std::vector<int> categories{};
+};
+
+/**
+ * A trained tree compiled for inference into one contiguous array of nodes.
+ *
+ * The nodes are laid out depth first and the leaves are stored in an array
+ * of their own, so that walking the tree follows indices instead of the
+ * shared pointers of the Node graph. By default the true branch of a node is
+ * placed right after it. With a sample of rows, the branch taken most often
+ * by the sample is placed there instead, and the subtrees the sample never
+ * reaches are moved after all the other nodes, so that the frequent paths
+ * are packed in the first cache lines of the array.
+ *
+ * A flat tree gives the predictions of TreeTest::classify on the same rows.
+ */
+class FlatTree {
+public:
+	FlatTree() = default;
+	FlatTree(const Node& root, const MetaData& meta);
+	// layout guided by the branches taken by the sample rows, for example training rows or recent traffic
+	FlatTree(const Node& root, const MetaData& meta, const Data& sample);
+
+	static FlatRow encode(const VecS& row, const MetaData& meta);
+
+	// when visits is given, the number of nodes visited (leaf included) is added to it
+	const Leaf& classify(const FlatRow& row, uint64_t* visits = nullptr) const;
+
+	inline size_t size() const { return nodes_.size(); }
+	// bytes of the node and leaf arrays
+	size_t bytes() const;
+
+private:
+	// 24 bytes, a cache line holds the nodes of a short path
+	struct FlatNode {
+		// numeric questions ask for values greater or equal than the threshold
+		double threshold = 0;
+		// -1 for a leaf
+		int32_t column = -1;
+		// categorical questions ask for this category id, NumericQuestion for numeric questions
+		int32_t category = 0;
+		// a leaf keeps the index of its Leaf in trueChild
+		uint32_t trueChild = 0;
+		uint32_t falseChild = 0;
+	};
+	static constexpr int32_t NumericQuestion = -1;
+	// a category missing from the meta data never matches, unlike the -1 of the unknown row values
+	static constexpr int32_t UnknownCategory = -2;
+
+	std::vector<FlatNode> nodes_{};
+	std::vector<Leaf> leaves_{};
+
+	// NaN, a value that is not a number, fails every numeric question; a number never equals a category
+	static inline bool answer(const FlatNode& node, const FlatRow& row) {
+		const double number = row.numbers[node.column];
+		return node.category == NumericQuestion ? number >= node.threshold
+			: std::isnan(number) && row.categories[node.column] == node.category;
+	}
+	// fills the arrays, depth first or guided by the rows reaching every node; returns the node of every index
+	std::vector<const Node*> layout(const Node& root, const MetaData& meta, const std::unordered_map<const Node*, uint64_t>* reached);
+};
+
+#endif //DECISIONTREE_FLATTREE_HPP
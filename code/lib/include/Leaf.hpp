@@ -1,6 +1,7 @@
 #ifndef DECISIONTREE_LEAF_HPP
 #define DECISIONTREE_LEAF_HPP
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -8,26 +9,39 @@
  // You can change these data types
 using Data = std::vector<std::vector<std::string>>;
 using ClassCounter = std::unordered_map<std::string, int>;
+// class counts indexed by class id, the class names are interned in MetaData::classNames
+using ClassCounts = std::vector<uint32_t>;
 
 
 /**
  * Representation of a decision tree leaf node.
  *
  * A leaf stores the number of examples of each class that ended up in the
- * leaf during training.
- *
- * NOTE: This class should not be altered!
+ * leaf during training, as a dense array indexed by class id, together with
+ * the id of the majority class. The leaves of the regression trees fitted by
+ * Boosting hold a raw score instead of class counts.
  */
 class Leaf {
 public:
 	Leaf() = delete;
-	explicit Leaf(const ClassCounter cc);
+	explicit Leaf(ClassCounts counts);
+	// leaf of a regression tree, without class counts
+	explicit Leaf(double value);
 	virtual ~Leaf() = default;
 
-	inline const ClassCounter predictions() const { return predictions_; }
+	inline const ClassCounts& counts() const { return counts_; }
+	// class id of the majority class, the lowest id wins ties
+	inline uint32_t prediction() const { return prediction_; }
+	// raw score of a regression leaf, 0 for a classification leaf
+	inline double value() const { return value_; }
+	uint32_t total() const;
+	// class counts keyed by class name, used for printing
+	const ClassCounter predictions(const std::vector<std::string>& classNames) const;
 
 private:
-	const ClassCounter predictions_;
+	ClassCounts counts_;
+	uint32_t prediction_;
+	double value_;
 
 };
 
@@ -0,0 +1,122 @@
+#ifndef DECISIONTREE_MEMORY_HPP
+#define DECISIONTREE_MEMORY_HPP
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Node.hpp"
+#include "Utils.hpp"
+
+/**
+ * Thrown when training would exceed the configured memory budget.
+ */
+class MemoryBudgetExceeded : public std::runtime_error {
+public:
+	MemoryBudgetExceeded(const std::string& what, size_t requested, size_t inUse, size_t budget);
+};
+
+/**
+ * Accounts the bytes held by the library while training.
+ *
+ * Allocations are reserved before they are made, so that a training run which
+ * would exceed the budget fails before the memory is actually requested. The
+ * tracker can be shared by the threads building a tree.
+ */
+class MemoryTracker {
+public:
+	// a budget of 0 means unlimited, reservations are forwarded to the parent tracker when there is one
+	explicit MemoryTracker(size_t budget = 0, MemoryTracker* parent = nullptr);
+	MemoryTracker(const MemoryTracker&) = delete;
+	MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+	// account for an allocation, throws MemoryBudgetExceeded when the budget would be exceeded
+	void reserve(size_t bytes, const char* what);
+	void release(size_t bytes);
+	// restart the peak measurement from the current usage
+	void resetPeak();
+
+	inline size_t current() const { return current_.load(std::memory_order_relaxed); }
+	inline size_t peak() const { return peak_.load(std::memory_order_relaxed); }
+	inline size_t budget() const { return budget_; }
+
+private:
+	const size_t budget_;
+	MemoryTracker* parent_;
+	std::atomic<size_t> current_;
+	std::atomic<size_t> peak_;
+};
+
+/**
+ * Reservation on a MemoryTracker which is released when it goes out of scope.
+ */
+class MemoryReservation {
+public:
+	// a null tracker makes the reservation a no-op
+	MemoryReservation(MemoryTracker* tracker, size_t bytes, const char* what);
+	MemoryReservation(const MemoryReservation&) = delete;
+	MemoryReservation& operator=(const MemoryReservation&) = delete;
+	~MemoryReservation();
+
+	// give back the part of the reservation which was not needed
+	void shrink(size_t bytes);
+
+private:
+	MemoryTracker* tracker_;
+	size_t bytes_;
+};
+
+/**
+ * Bytes held by the tables of a DataReader.
+ */
+struct DataMemory {
+	size_t trainStrings = 0;
+	size_t testStrings = 0;
+	size_t trainInt = 0;
+
+	inline size_t total() const { return trainStrings + testStrings + trainInt; }
+	std::string toJson() const;
+};
+
+/**
+ * Memory used by the training of an ensemble.
+ */
+struct MemoryReport {
+	DataMemory data{};
+	// per tree: the bootstrap sample, the Node/Leaf graph and the peak of the transient
+	// row partitions allocated while building the tree
+	std::vector<size_t> bootstrapBytes{};
+	std::vector<size_t> treeBytes{};
+	std::vector<size_t> peakTransientBytes{};
+	// peak of all the bytes accounted during the training
+	size_t peakTrackedBytes = 0;
+	size_t budget = 0;
+
+	size_t modelBytes() const;
+	std::string toJson() const;
+};
+
+namespace Memory {
+
+	size_t bytes(const Data& data);
+
+	size_t bytes(const DataInt& data);
+
+	size_t bytes(const std::vector<VecI*>& rows);
+
+	// bytes held by the nodes and leaves reachable from the root, the root itself excluded
+	// shared subtrees are only counted once
+	size_t treeBytes(const Node& root);
+	// bytes of every tree of an ensemble, its root included; the nodes and leaves a tree shares with
+	// an earlier tree are counted with the earlier tree, so the sum holds every object once
+	std::vector<size_t> forestBytes(const std::vector<Node>& roots);
+
+	// estimate of the bytes of a bootstrap sample before it is drawn
+	size_t bootstrapBytes(size_t rows, size_t columns);
+
+	// peak resident set size of the process
+	size_t peakRssBytes();
+
+} // namespace Memory
+
+#endif //DECISIONTREE_MEMORY_HPP
@@ -0,0 +1,163 @@
+#ifndef DECISIONTREE_METRICS_HPP
+#define DECISIONTREE_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Metrics are recorded unless the library is compiled with DECISIONTREE_METRICS=0,
+// in which case every recording call compiles to nothing.
+#ifndef DECISIONTREE_METRICS
+#define DECISIONTREE_METRICS 1
+#endif
+
+/**
+ * A counter which can be updated concurrently by the threads building a tree.
+ *
+ * Updates use relaxed atomics: only the final values are of interest, they are
+ * read once the training or the predictions are done.
+ */
+class Counter {
+public:
+	Counter(uint64_t value = 0) : value_(value) {}
+	Counter(const Counter& other) : value_(other.value()) {}
+	Counter& operator=(const Counter& other) {
+		value_.store(other.value(), std::memory_order_relaxed);
+		return *this;
+	}
+
+	inline void add(uint64_t n) {
+#if DECISIONTREE_METRICS
+		value_.fetch_add(n, std::memory_order_relaxed);
+#endif
+	}
+
+	inline void max(uint64_t n) {
+#if DECISIONTREE_METRICS
+		uint64_t current = value_.load(std::memory_order_relaxed);
+		while (current < n && !value_.compare_exchange_weak(current, n, std::memory_order_relaxed)) {}
+#endif
+	}
+
+	inline uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> value_;
+};
+
+namespace Metrics {
+
+	// phases of the training, the times of a phase are summed over all threads working on it
+	enum Phase { Load, Encode, Bootstrap, SplitSearch, Partition, NodeConstruction, PhaseCount };
+
+	const char* phaseName(Phase phase);
+
+	// deeper nodes are counted in the last bucket of the depth histogram
+	constexpr size_t MaxDepthBucket = 64;
+
+	// CPU time consumed by the calling thread
+	uint64_t threadCpuNanoseconds();
+
+} // namespace Metrics
+
+/**
+ * Wall clock and CPU time spent in every phase, in nanoseconds.
+ */
+struct PhaseTimes {
+	std::array<Counter, Metrics::PhaseCount> wallNs{};
+	std::array<Counter, Metrics::PhaseCount> cpuNs{};
+
+	void add(const PhaseTimes& other);
+	std::string toJson() const;
+};
+
+/**
+ * Measures the wall clock and CPU time of a scope and adds it to a phase.
+ */
+class ScopedPhase {
+public:
+	ScopedPhase(PhaseTimes* times, Metrics::Phase phase);
+	ScopedPhase(const ScopedPhase&) = delete;
+	ScopedPhase& operator=(const ScopedPhase&) = delete;
+	~ScopedPhase();
+
+private:
+#if DECISIONTREE_METRICS
+	PhaseTimes* times_;
+	Metrics::Phase phase_;
+	std::chrono::steady_clock::time_point wallStart_;
+	uint64_t cpuStart_;
+#endif
+};
+
+/**
+ * Statistics of the construction of one tree.
+ */
+struct TreeMetrics {
+	PhaseTimes phases{};
+	// wall clock time of the whole tree construction
+	Counter wallNs{};
+	Counter nodes{}; // every node, leaves included
+	Counter leaves{};
+	Counter maxDepth{};
+	// number of leaves at every depth
+	std::array<Counter, Metrics::MaxDepthBucket> depthHistogram{};
+	// number of (row, column) values sorted by the split search
+	Counter rowsSorted{};
+	// threads started by the asynchronous construction of large subtrees
+	Counter threadsSpawned{};
+	// nodes large enough for their rows to be split over threads
+	Counter rowParallelNodes{};
+
+	void recordLeaf(size_t depth);
+	std::string toJson() const;
+};
+
+/**
+ * Statistics of the training of an ensemble.
+ *
+ * The phases hold the totals over all trees plus the data set loading and
+ * encoding, which are done once.
+ */
+struct TrainingMetrics {
+	PhaseTimes phases{};
+	Counter wallNs{};
+	std::vector<TreeMetrics> trees{};
+
+	std::string toJson() const;
+};
+
+/**
+ * Trees built by a training limited by a wall clock budget, see BaggingOptions::timeBudget.
+ */
+struct TimeBudgetReport {
+	double budgetSeconds = 0;
+	double elapsedSeconds = 0;
+	size_t treesPlanned = 0;
+	size_t treesBuilt = 0;
+	// "time" when no tree was expected to finish in the time left, "memory" when a tree exceeded the
+	// memory budget, empty when every planned tree was built
+	std::string stoppedBy{};
+	// mean build time of the trees, the estimate of the next tree when the training stopped
+	double estimateSeconds = 0;
+	// wall clock build time of every tree built, in the order of their seeds
+	std::vector<double> treeSeconds{};
+
+	std::string toJson() const;
+};
+
+/**
+ * Statistics of the predictions made by an ensemble.
+ */
+struct InferenceMetrics {
+	Counter predictions{};
+	// nodes visited over all trees, leaves included
+	Counter nodeVisits{};
+
+	std::string toJson() const;
+};
+
+#endif //DECISIONTREE_METRICS_HPP
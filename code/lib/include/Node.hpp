@@ -20,6 +20,8 @@ public:
 	Node();
 	explicit Node(Leaf l);
 	Node(const Node& trueBranch, const Node& falseBranch, const Question& question);
+	// links the branches instead of copying them, so that several parents can share a subtree
+	Node(std::shared_ptr<const Node> trueBranch, std::shared_ptr<const Node> falseBranch, const Question& question);
 	virtual ~Node() = default;
 
 	const std::shared_ptr<Node> trueBranch() const { return trueBranch_; }
@@ -0,0 +1,80 @@
+#ifndef DECISIONTREE_PREDICTIONCACHE_HPP
+#define DECISIONTREE_PREDICTIONCACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FlatTree.hpp"
+#include "Metrics.hpp"
+
+/**
+ * Bounded cache of the class predicted for a row, shared by concurrent predictions.
+ *
+ * The key of a row holds the values of the columns the model asks about, as
+ * FlatTree::encode sees them, so rows that only differ in columns no tree
+ * uses share an entry. Every entry is tagged with the version of the model
+ * that predicted it and a lookup with another version misses: a model that
+ * changes takes a new version and never sees the entries of the old one.
+ *
+ * The entries are spread over shards holding a mutex each. A full shard
+ * evicts with the CLOCK algorithm: the hand skips the entries hit since it
+ * last passed them, clearing their mark, and replaces the first unmarked one.
+ */
+class PredictionCache {
+public:
+	using Key = std::vector<uint64_t>;
+
+	PredictionCache() = delete;
+	explicit PredictionCache(size_t capacity, size_t shards = 16);
+	PredictionCache(const PredictionCache&) = delete;
+	PredictionCache& operator=(const PredictionCache&) = delete;
+
+	// the values of the columns of the row, numbers by their bits and other values by their category id
+	static Key key(const FlatRow& row, const std::vector<int>& columns);
+
+	// true and the prediction when the key was predicted by this version of the model
+	bool find(const Key& key, uint64_t version, uint32_t& prediction);
+	void insert(const Key& key, uint64_t version, uint32_t prediction);
+	void clear();
+
+	inline size_t capacity() const { return capacity_; }
+	size_t size() const;
+	inline uint64_t hits() const { return hits_.value(); }
+	inline uint64_t misses() const { return misses_.value(); }
+	inline uint64_t evictions() const { return evictions_.value(); }
+	std::string toJson() const;
+
+private:
+	struct Entry {
+		Key key{};
+		uint64_t version = 0;
+		uint32_t prediction = 0;
+		// set by a hit, cleared by the passing hand
+		bool referenced = false;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	struct Shard {
+		mutable std::mutex mutex{};
+		std::vector<Entry> entries{};
+		std::unordered_map<Key, size_t, KeyHash> index{};
+		size_t hand = 0;
+	};
+
+	size_t capacity_;
+	size_t shardCapacity_;
+	std::vector<std::unique_ptr<Shard>> shards_;
+	Counter hits_;
+	Counter misses_;
+	Counter evictions_;
+
+	Shard& shard(const Key& key);
+};
+
+#endif //DECISIONTREE_PREDICTIONCACHE_HPP
@@ -0,0 +1,113 @@
+#ifndef DECISIONTREE_PREDICTIONSERVER_HPP
+#define DECISIONTREE_PREDICTIONSERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bagging.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * Configuration of the micro-batching of a PredictionServer.
+ *
+ * A batch is evaluated as soon as it holds maxBatchSize requests, or when the
+ * oldest request in the queue has waited maxWait.
+ */
+struct ServerOptions {
+	size_t maxBatchSize = 64;
+	std::chrono::microseconds maxWait{ 500 };
+	size_t threads = ThreadPool::defaultThreads();
+	// number of most recent request latencies kept to compute the percentiles
+	size_t latencyWindow = 100000;
+};
+
+/**
+ * Latency percentiles in microseconds, measured from the submission of a
+ * request until its prediction is available.
+ */
+struct LatencyReport {
+	size_t count = 0;
+	double p50 = 0;
+	double p90 = 0;
+	double p99 = 0;
+	double p999 = 0;
+	double max = 0;
+
+	std::string toJson() const;
+};
+
+/**
+ * Scoring daemon serving a trained ensemble.
+ *
+ * Concurrent requests are gathered in micro-batches which are evaluated on a
+ * pool of threads. Requests can be submitted directly, or through a line
+ * protocol served on a stream (stdin/stdout) or on a UNIX domain socket.
+ *
+ * Protocol: every request is one line of comma separated attribute values in
+ * the column order of the model meta data (the class column last, it can be
+ * omitted). The response is one line holding the predicted label, or a line
+ * starting with "ERROR" when the request can not be scored. The line "STATS"
+ * is answered with the latency report in JSON. Responses of a connection are
+ * written in the order of the requests.
+ */
+class PredictionServer {
+public:
+	PredictionServer() = delete;
+	explicit PredictionServer(const Bagging& model, ServerOptions options = {});
+	PredictionServer(const PredictionServer&) = delete;
+	PredictionServer& operator=(const PredictionServer&) = delete;
+	~PredictionServer();
+
+	// queue one row for scoring
+	std::future<std::string> submit(VecS row);
+
+	// serve the line protocol until the input stream ends
+	void serveStream(std::istream& in, std::ostream& out);
+	// serve the line protocol on a UNIX domain socket until stop() is called, then answer the requests already
+	// read, close the connections and remove the socket file
+	void serveUnixSocket(const std::string& path);
+	// stop accepting socket connections and stop the batching thread
+	void stop();
+
+	LatencyReport latency() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Request {
+		VecS row;
+		std::promise<std::string> result;
+		Clock::time_point arrival;
+	};
+
+	const Bagging& model_;
+	const ServerOptions options_;
+	ThreadPool pool_;
+
+	std::deque<Request> queue_;
+	std::mutex queueMutex_;
+	std::condition_variable queueCondition_;
+	std::atomic<bool> stopping_;
+
+	// ring buffer of the most recent latencies in microseconds
+	std::vector<double> latencies_;
+	size_t latencyCount_;
+	mutable std::mutex latencyMutex_;
+
+	std::thread batcher_;
+
+	void batchLoop();
+	void runBatch(std::vector<Request>& batch);
+	void recordLatencies(const std::vector<double>& latencies);
+	void serveLines(const std::function<bool(std::string&)>& readLine, const std::function<void(const std::string&)>& writeLine);
+};
+
+#endif //DECISIONTREE_PREDICTIONSERVER_HPP
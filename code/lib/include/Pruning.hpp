@@ -0,0 +1,58 @@
+#ifndef DECISIONTREE_PRUNING_HPP
+#define DECISIONTREE_PRUNING_HPP
+
+#include <string>
+#include <vector>
+#include "Node.hpp"
+#include "Utils.hpp"
+
+/**
+ * One subtree of the minimal cost-complexity pruning sequence of a tree.
+ */
+struct PruningStep {
+	// the subtree is the smallest one minimising training errors + alpha * leaves
+	double alpha = 0;
+	size_t nodes = 0;
+	size_t leaves = 0;
+	// fraction of the training rows of the tree it misclassifies, from the class counts of the leaves
+	double trainingError = 0;
+	// accuracy on the validation rows, 0 without validation rows
+	double validationAccuracy = 0;
+};
+
+/**
+ * Post-training pruning of the trees built by DecisionTree.
+ *
+ * The class counts of the leaves are the training rows of the tree, so the
+ * counts of an inner node, and the training errors of collapsing it into a
+ * leaf, are those of its leaves summed. A pruned tree replaces collapsed
+ * subtrees by leaves holding these counts, and predicts their majority class.
+ *
+ * Minimal cost-complexity pruning (Breiman et al.) collapses the weakest link
+ * repeatedly: the inner node whose subtree reduces the training error the least
+ * per additional leaf, g(t) = (R(t) - R(T_t)) / (|leaves(T_t)| - 1). The values
+ * of g at which nodes are collapsed form the alpha path. Reduced-error pruning
+ * collapses, bottom up, every inner node whose subtree does not classify more
+ * validation rows correctly than the node would as a leaf.
+ */
+namespace Pruning {
+
+	// the pruning sequence from the full tree (alpha 0) to the root alone, scored on the validation rows when given
+	std::vector<PruningStep> costComplexityPath(const Node& root, const MetaData& meta, const Data& validation = {});
+
+	// the subtree of the sequence for alpha, every node with g(t) <= alpha is collapsed
+	Node costComplexity(const Node& root, double alpha);
+
+	// collapses the subtrees which do not improve the accuracy on the validation rows, ties are collapsed
+	Node reducedError(const Node& root, const MetaData& meta, const Data& validation);
+
+	// nodes, leaves and training error of a tree, and its accuracy on the validation rows when given
+	PruningStep evaluate(const Node& root, const MetaData& meta, const Data& validation = {});
+
+	size_t countNodes(const Node& root);
+
+	std::string toJson(const std::vector<PruningStep>& path);
+
+} // namespace Pruning
+
+#endif //DECISIONTREE_PRUNING_HPP
@@ -16,7 +16,7 @@ public:
 	Question();
 	Question(const int column, const std::string value);
 
-	const bool solve(VecS example) const;
+	const bool solve(const VecS& example) const;
 	const bool isNumeric(std::string value) const;
 	const bool isNumeric(void) const;
 	const std::string toString(const VecS& labels) const;
@@ -0,0 +1,35 @@
+#ifndef DECISIONTREE_SERIALIZATION_HPP
+#define DECISIONTREE_SERIALIZATION_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include "Node.hpp"
+#include "Utils.hpp"
+
+/**
+ * Text serialization of the meta data and trees of a model.
+ *
+ * Strings are written with their length as prefix ("5:Sunny") so that values
+ * can contain any character. A tree is written in pre-order, one node per
+ * line: "N <column> <value>" for a question node followed by its true and
+ * false branch, "L <n> <count>..." for a leaf holding n class counts.
+ * Malformed input raises a std::runtime_error.
+ */
+namespace Serialization {
+
+	void writeString(std::ostream& out, const std::string& value);
+
+	std::string readString(std::istream& in);
+
+	void writeMetaData(std::ostream& out, const MetaData& meta);
+
+	MetaData readMetaData(std::istream& in);
+
+	void writeTree(std::ostream& out, const Node& root);
+
+	Node readTree(std::istream& in);
+
+} // namespace Serialization
+
+#endif //DECISIONTREE_SERIALIZATION_HPP
@@ -0,0 +1,98 @@
+#ifndef DECISIONTREE_THREADPOOL_HPP
+#define DECISIONTREE_THREADPOOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A fixed size pool of worker threads executing submitted tasks in FIFO order.
+ *
+ * Tasks must not block on other tasks of the same pool (for example by calling
+ * parallelFor from inside a task), as all workers could end up waiting.
+ */
+class ThreadPool {
+public:
+	ThreadPool() = delete;
+	explicit ThreadPool(size_t threads);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	inline size_t size() const { return workers_.size(); }
+
+	// queue a task and return a future holding its result
+	template<class F>
+	std::future<std::invoke_result_t<F>> submit(F&& f) {
+		using R = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+		std::future<R> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			tasks_.emplace([task]() { (*task)(); });
+		}
+		condition_.notify_one();
+		return result;
+	}
+
+	// split the range [0, n) in contiguous chunks, run f(begin, end) on each chunk and wait for all of them
+	// chunks are never smaller than minChunk so that tiny ranges are processed by the calling thread only
+	template<class F>
+	void parallelFor(size_t n, F f, size_t minChunk = 1) {
+		size_t chunks = std::min(size(), std::max<size_t>(1, n / std::max<size_t>(1, minChunk)));
+		if (chunks <= 1) {
+			f(size_t(0), n);
+			return;
+		}
+		std::vector<std::future<void>> pending;
+		pending.reserve(chunks - 1);
+		size_t step = (n + chunks - 1) / chunks;
+		// the calling thread processes the first chunk itself
+		for (size_t begin = step; begin < n; begin += step) {
+			size_t end = std::min(n, begin + step);
+			pending.push_back(submit([&f, begin, end]() { f(begin, end); }));
+		}
+		// the chunks reference f and the buffers of the caller, so every chunk has to finish
+		// before the first failure, of any chunk, is rethrown
+		std::exception_ptr error;
+		try {
+			f(size_t(0), std::min(n, step));
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		for (auto& p : pending) {
+			try {
+				p.get();
+			}
+			catch (...) {
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	// number of threads to use when the caller did not configure one
+	static size_t defaultThreads();
+
+private:
+	std::vector<std::thread> workers_;
+	std::queue<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool stopping_;
+
+	void workerLoop();
+};
+
+#endif //DECISIONTREE_THREADPOOL_HPP
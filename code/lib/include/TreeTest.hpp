@@ -12,11 +12,14 @@ public:
 	TreeTest(const Data& testData, const MetaData& meta, const Node& root);
 	~TreeTest() = default;
 
-	const ClassCounter classify(const VecS& row, std::shared_ptr<Node> node) const;
+	const Leaf& classify(const VecS& row, std::shared_ptr<Node> node) const;
+	// iterative variant walking the tree from a root held by value, without copying nodes
+	// when visits is given, the number of nodes visited (leaf included) is added to it
+	const Leaf& classify(const VecS& row, const Node& root, uint64_t* visits = nullptr) const;
 
 private:
-	void printLeaf(ClassCounter counts) const;
-	void test(const Data& testing_data, const VecS& labels, std::shared_ptr<Node> tree) const;
+	void printLeaf(const Leaf& leaf, const VecS& classNames) const;
+	void test(const Data& testing_data, const MetaData& meta, std::shared_ptr<Node> tree) const;
 };
 
 #endif //DECISIONTREE_TREETEST_HPP
@@ -0,0 +1,73 @@
+#ifndef DECISIONTREE_TUNING_HPP
+#define DECISIONTREE_TUNING_HPP
+
+#include <string>
+#include <vector>
+#include "Bagging.hpp"
+#include "DataReader.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * Values of the parameters to search, every combination is a configuration.
+ */
+struct ParameterGrid {
+	std::vector<int> ensembleSize{ 10 };
+	std::vector<size_t> maxDepth{ 0 };
+	std::vector<size_t> minRowsSplit{ 2 };
+};
+
+struct SearchOptions {
+	size_t folds = 5;
+	// seed of the assignment of the rows to the folds
+	uint seed = 1234;
+	// 0 evaluates every configuration of the grid, otherwise this many configurations drawn from it
+	size_t randomSamples = 0;
+	size_t threads = ThreadPool::defaultThreads();
+};
+
+/**
+ * Cross-validated scores and timings of one configuration.
+ */
+struct SearchResult {
+	BaggingOptions options{};
+	std::vector<double> foldAccuracy{};
+	double accuracy = 0;
+	double accuracyStd = 0;
+	double logLoss = 0;
+	// time spent building and scoring the trees of the configuration, summed over the threads
+	double cpuSeconds = 0;
+	// from the start of the first to the end of the last job of the configuration
+	double wallSeconds = 0;
+};
+
+/**
+ * Cross-validation and hyperparameter search of Bagging ensembles.
+ *
+ * The data set is parsed and encoded once. Each fold is a view over the
+ * encoded rows: row pointers for training and the string rows held out for
+ * scoring. The folds are built once and shared by all the configurations.
+ * Every tree of every (configuration, fold) pair is one job of a single
+ * thread pool. The last tree of a pair scores the pair with a VoteTally and
+ * frees its trees, so memory is bounded by the pairs in flight.
+ */
+namespace Tuning {
+
+	// every combination of the grid values, the other parameters are those of base
+	std::vector<BaggingOptions> grid(const ParameterGrid& grid, const BaggingOptions& base);
+
+	// count configurations drawn without replacement, in a random order given by the seed
+	std::vector<BaggingOptions> sample(const std::vector<BaggingOptions>& configurations, size_t count, uint seed);
+
+	// k-fold cross-validation of every configuration on the training data of dr
+	std::vector<SearchResult> crossValidate(const DataReader& dr, const std::vector<BaggingOptions>& configurations, const SearchOptions& options);
+
+	// grid search, or random search when options.randomSamples is set, the results are sorted by accuracy
+	std::vector<SearchResult> search(const DataReader& dr, const ParameterGrid& grid, const BaggingOptions& base, const SearchOptions& options);
+
+	std::string toTable(const std::vector<SearchResult>& results);
+
+	std::string toJson(const std::vector<SearchResult>& results);
+
+} // namespace Tuning
+
+#endif //DECISIONTREE_TUNING_HPP
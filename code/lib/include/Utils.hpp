@@ -34,6 +34,9 @@ struct MetaData {
 	// vector of mappings for categorical attributes linking a numeric value used in the DataInt table (key) 
 	// to the attribute string value in the Data table  
 	VecMapI2S mapI2S;
+	// names of the classes of the decision column, indexed by class id
+	// interned once so that leaves only need to store class ids
+	VecS classNames;
 };
 
 
@@ -0,0 +1,56 @@
+#ifndef DECISIONTREE_VALIDATION_HPP
+#define DECISIONTREE_VALIDATION_HPP
+
+#include <string>
+#include <vector>
+#include "Node.hpp"
+#include "Utils.hpp"
+
+/**
+ * Class votes of an ensemble on a set of labelled rows, updated one tree at a time.
+ *
+ * The accuracy is that of the majority vote, as predicted by Bagging. The
+ * log-loss uses the class frequencies of the leaves averaged over the trees
+ * that voted for a row. Rows whose class is unknown to the meta data are not
+ * scored, neither are rows no tree voted for yet.
+ */
+class VoteTally {
+public:
+	VoteTally() = delete;
+	VoteTally(const Data& rows, const MetaData& meta);
+
+	// adds the votes of a tree, on every row or, with a mask, on the rows for which it is false
+	// (the out-of-bag rows when the mask holds the rows of the bootstrap sample)
+	void add(const Node& root, const std::vector<bool>& skip = {});
+
+	double accuracy() const;
+	double logLoss() const;
+	size_t rowsScored() const;
+
+private:
+	const Data& rows_;
+	size_t classes_;
+	// class id of every row, -1 when the class is unknown
+	std::vector<int> labels_;
+	// votes and summed leaf frequencies, row * classes + class id
+	std::vector<uint32_t> votes_;
+	std::vector<double> frequencies_;
+	// number of trees which voted for every row
+	std::vector<uint32_t> trees_;
+};
+
+/**
+ * Result of the early stopping of an ensemble training.
+ */
+struct EarlyStoppingReport {
+	bool stopped = false;
+	size_t treesTrained = 0;
+	size_t treesKept = 0;
+	// validation signal after every trained tree
+	std::vector<double> accuracy{};
+	std::vector<double> logLoss{};
+
+	std::string toJson() const;
+};
+
+#endif //DECISIONTREE_VALIDATION_HPP
@@ -1,65 +1,715 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <set>
 #include "Bagging.hpp"
+#include "Serialization.hpp"
 
 using std::make_shared;
 using std::shared_ptr;
 using std::string;
-using boost::timer::cpu_timer;
+
+namespace {
+	// versions are unique over all ensembles, so that copies sharing a cache never mix their entries
+	uint64_t newVersion() {
+		static std::atomic<uint64_t> next(0);
+		return ++next;
+	}
+
+	// the columns some question of the trees asks about, in increasing order
+	std::vector<int> questionColumns(const std::vector<Node>& learners) {
+		std::set<int> columns;
+		std::vector<const Node*> stack;
+		for (const auto& root : learners) {
+			stack.push_back(&root);
+			while (!stack.empty()) {
+				const Node* node = stack.back();
+				stack.pop_back();
+				if (node->leaf() != nullptr)
+					continue;
+				columns.insert(node->question().column_);
+				stack.push_back(node->trueBranch().get());
+				stack.push_back(node->falseBranch().get());
+			}
+		}
+		return std::vector<int>(columns.begin(), columns.end());
+	}
+}
 
 Bagging::Bagging(const DataReader& dr, const int ensembleSize, uint seed) :
-	dr_(dr),
-	ensembleSize_(ensembleSize),
-	learners_({}) {
-	random_number_generator.seed(seed);
-	buildBag();
-}
-
-
-void Bagging::buildBag() {
-	cpu_timer timer;
-	std::vector<double> timings;
-	// initialize a random generator to generate numbers from 0 up to the number of rows - 1
-	std::uniform_int_distribution<int> distribution(0, dr_.trainDataInt().size() - 1);
-	for (size_t i = 0; i < (size_t) ensembleSize_; i++) {
-		DataInt bootstrap_int;
-		timer.start();
-		//TODO: Implement bagging
-		//   Generate a bootstrap sample of the original data
-		//   Train an unpruned tree model on this sample
-		// 
-		// generating a bootstrap sample of the original data in int format
-		for (size_t row = 0; row < dr_.trainDataInt().size(); row++) {
-			bootstrap_int.push_back(dr_.trainDataInt().at(distribution(random_number_generator)));
+	Bagging(dr, BaggingOptions{ ensembleSize, seed }) {}
+
+Bagging::Bagging(const DataReader& dr, const BaggingOptions& options) :
+	dr_(make_shared<const DataReader>(dr)),
+	meta_(dr.metaData()),
+	ensembleSize_(options.ensembleSize),
+	memoryBudget_(options.memoryBudget),
+	threads_(std::max<size_t>(1, options.threads)),
+	earlyStopping_(options.earlyStopping),
+	timeBudget_(options.timeBudget),
+	treeOptions_(options.tree),
+	learners_({}),
+	compiled_(),
+	version_(newVersion()),
+	cache_(),
+	cacheColumns_(),
+	random_number_generator(options.seed),
+	seed_(options.seed),
+	seedsDrawn_(0),
+	trainingMetrics_(),
+	inferenceMetrics_(),
+	memoryReport_(),
+	earlyStoppingReport_(),
+	timeBudgetReport_() {
+	// loading and encoding happened in the DataReader
+	trainingMetrics_.phases.add(dr.metrics());
+	buildBag(ensembleSize_, {});
+}
+
+Bagging::Bagging(const DataReader& dr, const BaggingOptions& options, std::vector<Node> learners) :
+	dr_(make_shared<const DataReader>(dr)),
+	meta_(dr.metaData()),
+	ensembleSize_(static_cast<int>(learners.size())),
+	memoryBudget_(options.memoryBudget),
+	threads_(std::max<size_t>(1, options.threads)),
+	earlyStopping_(options.earlyStopping),
+	timeBudget_(options.timeBudget),
+	treeOptions_(options.tree),
+	learners_(std::move(learners)),
+	compiled_(),
+	version_(newVersion()),
+	cache_(),
+	cacheColumns_(),
+	random_number_generator(options.seed),
+	seed_(options.seed),
+	seedsDrawn_(0),
+	trainingMetrics_(),
+	inferenceMetrics_(),
+	memoryReport_(),
+	earlyStoppingReport_(),
+	timeBudgetReport_() {
+	trainingMetrics_.phases.add(dr.metrics());
+	memoryReport_.budget = memoryBudget_;
+	memoryReport_.data = dr.memoryUsage();
+	for (const auto& root : learners_)
+		memoryReport_.treeBytes.push_back(sizeof(Node) + Memory::treeBytes(root));
+	// the trees given are those of the first seeds, a grown ensemble continues with the seeds following them
+	seedsDrawn_ = learners_.size();
+	random_number_generator.discard(seedsDrawn_);
+}
+
+Bagging::Bagging(MetaData meta, std::vector<Node> learners) :
+	dr_(nullptr),
+	meta_(std::move(meta)),
+	ensembleSize_(static_cast<int>(learners.size())),
+	memoryBudget_(0),
+	threads_(1),
+	earlyStopping_(),
+	timeBudget_(0),
+	treeOptions_(),
+	learners_(std::move(learners)),
+	compiled_(),
+	version_(newVersion()),
+	cache_(),
+	cacheColumns_(),
+	random_number_generator(),
+	seed_(BaggingOptions().seed),
+	seedsDrawn_(0),
+	trainingMetrics_(),
+	inferenceMetrics_(),
+	memoryReport_(),
+	earlyStoppingReport_(),
+	timeBudgetReport_() {}
+
+
+size_t Bagging::grow(const DataReader& dr, const BaggingOptions& options, size_t window) {
+	const std::vector<uint32_t> classIds = mergeMetaData(dr.metaData());
+	dr_ = make_shared<const DataReader>(dr);
+	memoryBudget_ = options.memoryBudget;
+	threads_ = std::max<size_t>(1, options.threads);
+	earlyStopping_ = options.earlyStopping;
+	timeBudget_ = options.timeBudget;
+	treeOptions_ = options.tree;
+	// the new trees continue the seed sequence of the ensemble, after the seeds of the trees a window dropped
+	random_number_generator.seed(seed_);
+	random_number_generator.discard(seedsDrawn_);
+	trainingMetrics_.phases.add(dr.metrics());
+	const size_t before = learners_.size();
+	buildBag(options.ensembleSize, classIds);
+	const size_t added = learners_.size() - before;
+
+	// sliding window, the oldest trees are at the front
+	if (window > 0 && learners_.size() > window) {
+		const size_t dropped = learners_.size() - window;
+		learners_.erase(learners_.begin(), learners_.begin() + dropped);
+		// the trees of a loaded ensemble have no statistics, the statistics are those of the newest trees
+		auto dropFront = [window](auto& values) {
+			if (values.size() > window)
+				values.erase(values.begin(), values.begin() + (values.size() - window));
+		};
+		dropFront(trainingMetrics_.trees);
+		dropFront(memoryReport_.bootstrapBytes);
+		dropFront(memoryReport_.treeBytes);
+		dropFront(memoryReport_.peakTransientBytes);
+	}
+	ensembleSize_ = static_cast<int>(learners_.size());
+	// the compiled trees are those of the previous ensemble and meta data, the cached predictions too
+	compiled_.clear();
+	version_ = newVersion();
+	cacheColumns_ = questionColumns(learners_);
+	return added;
+}
+
+void Bagging::prune(double alpha) {
+	std::vector<Node> pruned;
+	for (const auto& learner : learners_)
+		pruned.push_back(Pruning::costComplexity(learner, alpha));
+	replaceLearners(std::move(pruned));
+}
+
+void Bagging::prune(const Data& validation) {
+	std::vector<Node> pruned;
+	for (const auto& learner : learners_)
+		pruned.push_back(Pruning::reducedError(learner, meta_, validation));
+	replaceLearners(std::move(pruned));
+}
+
+std::vector<PruningStep> Bagging::pruningPath(const Data& validation, size_t points) const {
+	// the alphas at which the trees lose nodes, the points are spread over their quantiles
+	std::vector<double> alphas;
+	for (const auto& learner : learners_) {
+		for (const auto& step : Pruning::costComplexityPath(learner, meta_))
+			alphas.push_back(step.alpha);
+	}
+	std::sort(alphas.begin(), alphas.end());
+	alphas.erase(std::unique(alphas.begin(), alphas.end()), alphas.end());
+	points = std::max<size_t>(2, std::min(points, alphas.size()));
+
+	std::vector<PruningStep> path;
+	for (size_t p = 0; p < points; p++) {
+		PruningStep step;
+		step.alpha = alphas[p * (alphas.size() - 1) / (points - 1)];
+		VoteTally tally(validation, meta_);
+		for (const auto& learner : learners_) {
+			const Node pruned = Pruning::costComplexity(learner, step.alpha);
+			const PruningStep tree = Pruning::evaluate(pruned, meta_);
+			step.nodes += tree.nodes;
+			step.leaves += tree.leaves;
+			step.trainingError += tree.trainingError / learners_.size();
+			tally.add(pruned);
 		}
+		step.validationAccuracy = tally.accuracy();
+		path.push_back(step);
+	}
+	return path;
+}
 
-		// training unpruned tree model on the bootstrap
-		DecisionTree dt(dr_, bootstrap_int);
-		// store the learned decision tree 
-		learners_.emplace_back(dt);
+CompactionReport Bagging::compact() {
+	const CompactionReport report = Compaction::compact(learners_);
+	memoryReport_.treeBytes = Memory::forestBytes(learners_);
+	return report;
+}
 
-		auto nanoseconds = boost::chrono::nanoseconds(timer.elapsed().wall);
-		auto seconds = boost::chrono::duration_cast<boost::chrono::seconds>(nanoseconds);
-		timings.push_back(seconds.count());
+size_t Bagging::nodeCount() const {
+	size_t nodes = 0;
+	for (const auto& learner : learners_)
+		nodes += Pruning::countNodes(learner);
+	return nodes;
+}
+
+void Bagging::replaceLearners(std::vector<Node> learners) {
+	learners_ = std::move(learners);
+	memoryReport_.treeBytes.clear();
+	for (const auto& root : learners_)
+		memoryReport_.treeBytes.push_back(sizeof(Node) + Memory::treeBytes(root));
+	compiled_.clear();
+	version_ = newVersion();
+	cacheColumns_ = questionColumns(learners_);
+}
+
+std::vector<uint32_t> Bagging::mergeMetaData(const MetaData& other) {
+	if (other.labels != meta_.labels || other.isnumeric != meta_.isnumeric)
+		throw std::runtime_error("The data set does not have the columns of the ensemble");
+	// the questions of the trees hold category strings, so new values only need a new id
+	for (size_t col = 0; col < meta_.labels.size(); col++) {
+		if (meta_.isnumeric[col])
+			continue;
+		// iterate the ids in order so that the merged ids do not depend on the hash order
+		for (size_t id = 0; id < other.mapI2S[col].size(); id++) {
+			const string& value = other.mapI2S[col].at(id);
+			if (meta_.mapS2I[col].count(value) == 0) {
+				const int new_id = static_cast<int>(meta_.mapI2S[col].size());
+				meta_.mapS2I[col][value] = new_id;
+				meta_.mapI2S[col][new_id] = value;
+			}
+		}
 	}
-	float avg_timing = Utils::iterators::average(std::begin(timings), std::begin(timings) + std::min(5, ensembleSize_));
-	std::cout << "Average timing: " << avg_timing << std::endl;
+	// the class ids are the ids of the decision column
+	std::vector<uint32_t> classIds;
+	for (const auto& name : other.classNames) {
+		classIds.push_back(meta_.mapS2I.back().at(name));
+		if (classIds.back() >= meta_.classNames.size())
+			meta_.classNames.push_back(name);
+	}
+	return classIds;
 }
 
-void Bagging::test() const {
+Node Bagging::translateClasses(const Node& root, const std::vector<uint32_t>& classIds, size_t classes) {
+	if (const auto& leaf = root.leaf(); leaf != nullptr) {
+		ClassCounts counts(classes, 0);
+		for (size_t id = 0; id < leaf->counts().size(); id++)
+			counts[classIds[id]] = leaf->counts()[id];
+		return Node(Leaf(std::move(counts)));
+	}
+	return Node(translateClasses(*root.trueBranch(), classIds, classes), translateClasses(*root.falseBranch(), classIds, classes), root.question());
+}
+
+void Bagging::buildBag(int trees, const std::vector<uint32_t>& classIds) {
+	const auto start = std::chrono::steady_clock::now();
+	MemoryTracker memory(memoryBudget_);
+	memoryReport_.budget = memoryBudget_;
+	memoryReport_.data = dr_->memoryUsage();
+	// fail before the first tree when the data set alone does not fit
+	memory.reserve(memoryReport_.data.total(), "the data set");
+	// the trees kept by a warm start stay in memory
+	if (memoryReport_.modelBytes() > 0)
+		memory.reserve(memoryReport_.modelBytes(), "the trees of the ensemble");
+
+	const std::vector<uint64_t> seeds = drawSeeds(random_number_generator, trees);
+	// the seeds of trees early stopping or a time budget did not keep are used up as well
+	seedsDrawn_ += seeds.size();
+	if (earlyStopping_.patience > 0 && timeBudget_ > 0)
+		throw std::invalid_argument("Early stopping can not be combined with a time budget");
+
+	// a tree trained on a data set with other class ids has to vote with the ids of the ensemble
+	bool same_ids = true;
+	for (size_t id = 0; id < classIds.size(); id++)
+		same_ids = same_ids && classIds[id] == id;
+	// early stopping scores the trees with the ids of the ensemble, it translates them itself
+	const bool early_stopping = earlyStopping_.patience > 0;
+	std::vector<Learner> learners = early_stopping ? buildWithEarlyStopping(seeds, same_ids ? std::vector<uint32_t>() : classIds, memory)
+		: timeBudget_ > 0 ? buildWithinBudget(seeds, memory)
+		: buildLearners(*dr_, treeOptions_, seeds, threads_, memory);
+
+	// store the learned decision trees and their statistics in the order of their seeds
+	for (auto& learner : learners) {
+		memoryReport_.bootstrapBytes.push_back(learner.bootstrapBytes);
+		memoryReport_.treeBytes.push_back(learner.treeBytes);
+		memoryReport_.peakTransientBytes.push_back(learner.peakTransientBytes);
+		trainingMetrics_.phases.add(learner.metrics.phases);
+		trainingMetrics_.trees.push_back(learner.metrics);
+		learners_.push_back(same_ids || early_stopping ? std::move(learner.root) : translateClasses(learner.root, classIds, meta_.classNames.size()));
+	}
+	memoryReport_.peakTrackedBytes = std::max(memoryReport_.peakTrackedBytes, memory.peak());
+	trainingMetrics_.wallNs.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+std::vector<Bagging::Learner> Bagging::buildWithEarlyStopping(const std::vector<uint64_t>& seeds, const std::vector<uint32_t>& classIds, MemoryTracker& memory) {
+	const bool out_of_bag = earlyStopping_.holdout == nullptr;
+	if (out_of_bag && !dr_->hasTrainStrings())
+		throw std::runtime_error("Out-of-bag early stopping needs the training strings, keep them or give a holdout");
+	// only the trees of this training are scored, the trees kept by a warm start have no out-of-bag rows
+	VoteTally tally(out_of_bag ? dr_->trainData() : *earlyStopping_.holdout, meta_);
+	EarlyStoppingReport report;
+	std::vector<Learner> learners;
+	double best = 0;
+	size_t kept = 0;
+
+	for (size_t wave = 0; wave < seeds.size() && !report.stopped; wave += threads_) {
+		const std::vector<uint64_t> wave_seeds(seeds.begin() + wave, seeds.begin() + std::min(seeds.size(), wave + threads_));
+		for (auto& learner : buildLearners(*dr_, treeOptions_, wave_seeds, threads_, memory)) {
+			// the tally counts the votes with the class ids of the ensemble
+			if (!classIds.empty())
+				learner.root = translateClasses(learner.root, classIds, meta_.classNames.size());
+			tally.add(learner.root, out_of_bag ? learner.inBag : std::vector<bool>());
+			learner.inBag = std::vector<bool>();
+			learners.push_back(std::move(learner));
+			report.accuracy.push_back(tally.accuracy());
+			report.logLoss.push_back(tally.logLoss());
+			// the log-loss improves when it decreases, it is negated to compare both metrics the same way
+			const double signal = earlyStopping_.metric == EarlyStopping::Accuracy ? report.accuracy.back() : -report.logLoss.back();
+			if (kept == 0 || signal > best + earlyStopping_.minDelta) {
+				best = signal;
+				kept = learners.size();
+			}
+			else if (learners.size() - kept >= earlyStopping_.patience) {
+				report.stopped = true;
+				break;
+			}
+		}
+	}
+	report.treesTrained = learners.size();
+	report.treesKept = kept;
+	learners.resize(kept);
+	earlyStoppingReport_ = report;
+	return learners;
+}
+
+std::vector<Bagging::Learner> Bagging::buildWithinBudget(const std::vector<uint64_t>& seeds, MemoryTracker& memory) {
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
+	auto seconds = [](Clock::time_point since) { return std::chrono::duration<double>(Clock::now() - since).count(); };
+	TimeBudgetReport report;
+	report.budgetSeconds = timeBudget_;
+	report.treesPlanned = seeds.size();
+
+	std::vector<Learner> learners(seeds.size());
+	std::vector<double> tree_seconds(seeds.size(), -1);
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t running = 0, measured = 0;
+	double measured_seconds = 0;
+	std::exception_ptr memory_error, error;
+	const size_t threads = std::min<size_t>(threads_, std::max<size_t>(1, seeds.size()));
+	// the trees built concurrently share the threads of their large nodes
+	TreeOptions tree = treeOptions_;
+	tree.rowThreads = std::max<size_t>(1, treeOptions_.rowThreads / threads);
+	{
+		ThreadPool pool(threads);
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t launched = 0;
+		bool stopped = false;
+		while (true) {
+			// the first wave has no estimate yet, the next trees are started when a thread is free
+			while (!stopped && launched < seeds.size() && running < pool.size()) {
+				if (memory_error || error) {
+					stopped = true;
+					break;
+				}
+				if (measured > 0 && seconds(start) + measured_seconds / measured > timeBudget_) {
+					report.stoppedBy = "time";
+					stopped = true;
+					break;
+				}
+				const size_t i = launched++;
+				running++;
+				pool.submit([this, i, &tree, &seeds, &learners, &tree_seconds, &memory, &mutex, &finished, &running, &measured, &measured_seconds, &memory_error, &error, seconds]() {
+					const auto tree_start = Clock::now();
+					std::exception_ptr memory_failure, failure;
+					try {
+						learners[i] = buildLearner(*dr_, tree, seeds[i], memory);
+					}
+					catch (const MemoryBudgetExceeded&) {
+						memory_failure = std::current_exception();
+					}
+					catch (...) {
+						failure = std::current_exception();
+					}
+					std::lock_guard<std::mutex> guard(mutex);
+					if (!memory_failure && !failure) {
+						tree_seconds[i] = seconds(tree_start);
+						measured_seconds += tree_seconds[i];
+						measured++;
+					}
+					if (memory_failure && !memory_error)
+						memory_error = memory_failure;
+					if (failure && !error)
+						error = failure;
+					running--;
+					finished.notify_one();
+				});
+			}
+			if (running == 0)
+				break;
+			finished.wait(lock);
+		}
+	}
+	if (error)
+		std::rethrow_exception(error);
+	// the trees that ran out of memory are dropped, the training fails only when no tree fit
+	if (memory_error) {
+		if (measured == 0)
+			std::rethrow_exception(memory_error);
+		report.stoppedBy = "memory";
+	}
+
+	std::vector<Learner> built;
+	for (size_t i = 0; i < seeds.size(); i++) {
+		if (tree_seconds[i] < 0)
+			continue;
+		built.push_back(std::move(learners[i]));
+		report.treeSeconds.push_back(tree_seconds[i]);
+	}
+	report.treesBuilt = built.size();
+	report.estimateSeconds = measured > 0 ? measured_seconds / measured : 0;
+	report.elapsedSeconds = seconds(start);
+	timeBudgetReport_ = report;
+	return built;
+}
+
+std::vector<uint64_t> Bagging::drawSeeds(std::mt19937_64& generator, size_t count) {
+	std::vector<uint64_t> seeds(count);
+	for (auto& seed : seeds)
+		seed = generator();
+	return seeds;
+}
+
+std::vector<Bagging::Learner> Bagging::buildLearners(const DataReader& dr, const TreeOptions& options, const std::vector<uint64_t>& seeds, size_t threads, MemoryTracker& memory) {
+	std::vector<Learner> learners(seeds.size());
+	std::atomic<bool> failed(false);
+	{
+		ThreadPool pool(std::min<size_t>(threads, std::max<size_t>(1, seeds.size())));
+		// the trees built concurrently share the threads of their large nodes
+		TreeOptions tree = options;
+		tree.rowThreads = std::max<size_t>(1, options.rowThreads / pool.size());
+		std::vector<std::future<void>> pending;
+		for (size_t i = 0; i < seeds.size(); i++) {
+			pending.push_back(pool.submit([i, &dr, &tree, &seeds, &learners, &memory, &failed]() {
+				// once a tree failed the remaining ones are skipped
+				if (failed)
+					return;
+				try {
+					learners[i] = buildLearner(dr, tree, seeds[i], memory);
+				}
+				catch (...) {
+					failed = true;
+					throw;
+				}
+			}));
+		}
+		// wait for all the trees before rethrowing the first failure
+		std::exception_ptr error;
+		for (auto& p : pending) {
+			try {
+				p.get();
+			}
+			catch (...) {
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+		if (error)
+			std::rethrow_exception(error);
+	}
+	return learners;
+}
+
+Bagging::Learner Bagging::buildLearner(const DataReader& dr, const TreeOptions& options, uint64_t seed, MemoryTracker& memory) {
+	const DataInt& data = dr.trainDataInt();
+	const size_t rows = data.size();
+	// the tree accounts on a tracker of its own to measure its peak, the shared tracker enforces the budget
+	MemoryTracker tree_memory(0, &memory);
+	std::mt19937_64 generator(seed);
+	DataInt bootstrap_int;
+	PhaseTimes bootstrap_times;
+	Learner learner{ Node(), TreeMetrics(), 0, 0, 0 };
+
+	MemoryReservation bootstrap_memory(&tree_memory, Memory::bootstrapBytes(rows, dr.metaData().labels.size()), "a bootstrap sample");
+	// generating a bootstrap sample of the original data in int format
+	{
+		ScopedPhase phase(&bootstrap_times, Metrics::Bootstrap);
+		// initialize a random generator to generate numbers from 0 up to the number of rows - 1
+		std::uniform_int_distribution<int> distribution(0, rows - 1);
+		bootstrap_int.reserve(rows);
+		learner.inBag.assign(rows, false);
+		for (size_t row = 0; row < rows; row++) {
+			const int drawn = distribution(generator);
+			learner.inBag[drawn] = true;
+			bootstrap_int.push_back(data.at(drawn));
+		}
+	}
+
+	// training unpruned tree model on the bootstrap, measuring the peak of its row partitions;
+	// the random questions of Extra-Trees continue the random sequence of the bootstrap
+	TreeOptions tree_options = options;
+	tree_options.seed = generator();
+	const size_t baseline = tree_memory.current();
+	DecisionTree dt(dr, bootstrap_int, &tree_memory, tree_options);
+	learner.peakTransientBytes = tree_memory.peak() - baseline;
+	learner.bootstrapBytes = Memory::bytes(bootstrap_int);
+	learner.treeBytes = sizeof(Node) + Memory::treeBytes(dt.root_);
+	// the trees are kept until the end of the training, so they are accounted on the shared tracker
+	memory.reserve(learner.treeBytes, "a trained tree");
+
+	learner.root = dt.root_;
+	learner.metrics = dt.metrics();
+	learner.metrics.phases.add(bootstrap_times);
+	learner.metrics.wallNs.add(bootstrap_times.wallNs[Metrics::Bootstrap].value());
+	return learner;
+}
+
+void Bagging::compile() {
+	std::vector<FlatTree> compiled;
+	for (const auto& learner : learners_)
+		compiled.emplace_back(learner, meta_);
+	compiled_ = std::move(compiled);
+}
+
+void Bagging::compile(const Data& sample) {
+	// for example the training rows of a reader that dropped them
+	if (sample.empty()) {
+		compile();
+		return;
+	}
+	std::vector<FlatTree> compiled;
+	for (const auto& learner : learners_)
+		compiled.emplace_back(learner, meta_, sample);
+	compiled_ = std::move(compiled);
+}
+
+void Bagging::enableCache(size_t capacity) {
+	cache_ = std::make_shared<PredictionCache>(capacity);
+	cacheColumns_ = questionColumns(learners_);
+}
+
+void Bagging::disableCache() {
+	cache_.reset();
+}
+
+uint32_t Bagging::predictClass(const VecS& row) const {
+	inferenceMetrics_.predictions.add(1);
+	if (!cache_)
+		return vote(row, nullptr);
+	const FlatRow flat = FlatTree::encode(row, meta_);
+	const PredictionCache::Key key = PredictionCache::key(flat, cacheColumns_);
+	uint32_t prediction = 0;
+	if (!cache_->find(key, version_, prediction)) {
+		prediction = vote(row, &flat);
+		cache_->insert(key, version_, prediction);
+	}
+	return prediction;
+}
+
+uint32_t Bagging::vote(const VecS& row, const FlatRow* encoded) const {
 	TreeTest t;
+	uint64_t visits = 0;
+	// one vote per learner for the majority class of the leaf the row ends up in
+	ClassCounts votes(metaData().classNames.size(), 0);
+	if (!compiled_.empty()) {
+		// the values of the row are parsed once for all the trees
+		const FlatRow flat = encoded ? FlatRow() : FlatTree::encode(row, meta_);
+		for (const auto& tree : compiled_)
+			votes[tree.classify(encoded ? *encoded : flat, DECISIONTREE_METRICS ? &visits : nullptr).prediction()]++;
+	}
+	else {
+		for (const auto& learner : learners_)
+			votes[t.classify(row, learner, DECISIONTREE_METRICS ? &visits : nullptr).prediction()]++;
+	}
+	inferenceMetrics_.nodeVisits.add(visits);
+	return std::distance(votes.begin(), std::max_element(votes.begin(), votes.end()));
+}
+
+std::string Bagging::predict(const VecS& row) const {
+	return metaData().classNames[predictClass(row)];
+}
+
+VecS Bagging::predict(const Data& rows, ThreadPool& pool) const {
+	VecS predictions(rows.size());
+	// every chunk writes to its own range of the output, no synchronisation is needed
+	pool.parallelFor(rows.size(), [this, &rows, &predictions](size_t begin, size_t end) {
+		for (size_t row = begin; row < end; row++) {
+			predictions[row] = predict(rows[row]);
+		}
+	}, 16);
+	return predictions;
+}
+
+double Bagging::accuracy(const Data& rows, ThreadPool& pool) const {
+	if (rows.empty())
+		return 0;
+	const VecS predictions = predict(rows, pool);
+	size_t correct = 0;
+	for (size_t row = 0; row < rows.size(); row++) {
+		if (predictions[row] == rows[row].back())
+			correct++;
+	}
+	return static_cast<double>(correct) / rows.size();
+}
+
+Data Bagging::testData() const {
+	if (!dr_)
+		throw std::runtime_error("A loaded ensemble holds no data set");
+	return dr_->testData();
+}
+
+void Bagging::test() const {
+	if (!dr_)
+		throw std::runtime_error("A loaded ensemble holds no data set");
 	float accuracy = 0;
-	for (const auto& row : dr_.testData()) {
+	for (const auto& row : dr_->testData()) {
 		static size_t last = row.size() - 1;
-		std::vector<std::string> decisions;
-		for (int i = 0; i < ensembleSize_; i++) {
-			const std::shared_ptr<Node> root = std::make_shared<Node>(learners_.at(i).root_);
-			const auto& classification = t.classify(row, root);
-			decisions.push_back(Utils::tree::getMax(classification));
-		}
-		std::string prediction = Utils::iterators::mostCommon(decisions.begin(), decisions.end());
+		const std::string& prediction = metaData().classNames[predictClass(row)];
 		if (prediction == row[last])
 			accuracy += 1;
 	}
-	std::cout << "Total accuracy: " << (accuracy / dr_.testData().size()) << std::endl;
+	std::cout << "Total accuracy: " << (accuracy / dr_->testData().size()) << std::endl;
+}
+
+void Bagging::save(const std::string& filename) const {
+	std::ofstream file(filename);
+	if (!file)
+		throw std::runtime_error("Can't write file: " + filename);
+	file << "bagging 2\n";
+	file << "seeds " << seed_ << " " << seedsDrawn_ << "\n";
+	Serialization::writeMetaData(file, meta_);
+	file << "trees " << learners_.size() << "\n";
+	for (const auto& root : learners_)
+		Serialization::writeTree(file, root);
+	if (!file)
+		throw std::runtime_error("Can't write file: " + filename);
 }
 
+void Bagging::trainSlice(const DataReader& dr, const BaggingOptions& options, size_t begin, size_t end, std::ostream& out) {
+	if (begin > end || end > static_cast<size_t>(options.ensembleSize))
+		throw std::runtime_error("Invalid slice of the ensemble");
+	// the seeds of the whole ensemble are drawn to find the ones of the slice
+	std::mt19937_64 generator(options.seed);
+	std::vector<uint64_t> seeds = drawSeeds(generator, end);
+	seeds.erase(seeds.begin(), seeds.begin() + begin);
 
+	MemoryTracker memory(options.memoryBudget);
+	memory.reserve(dr.memoryUsage().total(), "the data set");
+	std::vector<Learner> learners = buildLearners(dr, options.tree, seeds, std::max<size_t>(1, options.threads), memory);
+	out << "slice " << begin << " " << end << "\n";
+	for (const auto& learner : learners)
+		Serialization::writeTree(out, learner.root);
+	if (!out)
+		throw std::runtime_error("Can't write the slice of the ensemble");
+}
+
+std::pair<size_t, std::vector<Node>> Bagging::readSlice(std::istream& in) {
+	string keyword;
+	size_t begin = 0, end = 0;
+	in >> keyword >> begin >> end;
+	if (keyword != "slice" || begin > end)
+		throw std::runtime_error("Malformed slice of the ensemble");
+	std::vector<Node> learners;
+	learners.reserve(end - begin);
+	for (size_t i = begin; i < end; i++)
+		learners.push_back(Serialization::readTree(in));
+	return { begin, std::move(learners) };
+}
+
+Bagging Bagging::load(const std::string& filename) {
+	std::ifstream file(filename);
+	if (!file)
+		throw std::runtime_error("Can't open file: " + filename);
+	string kind;
+	int version = 0;
+	file >> kind >> version;
+	if (kind != "bagging" || version < 1 || version > 2)
+		throw std::runtime_error("Not a bagging model: " + filename);
+	string keyword;
+	// models of version 1 do not hold their seeds, they were trained with the default seed
+	uint seed = BaggingOptions().seed;
+	size_t seedsDrawn = 0;
+	if (version >= 2) {
+		file >> keyword >> seed >> seedsDrawn;
+		if (keyword != "seeds")
+			throw std::runtime_error("Malformed model: " + filename);
+	}
+	MetaData meta = Serialization::readMetaData(file);
+	size_t trees = 0;
+	file >> keyword >> trees;
+	if (keyword != "trees")
+		throw std::runtime_error("Malformed model: " + filename);
+	std::vector<Node> learners;
+	learners.reserve(trees);
+	for (size_t i = 0; i < trees; i++)
+		learners.push_back(Serialization::readTree(file));
+	Bagging model(std::move(meta), std::move(learners));
+	model.seed_ = seed;
+	model.seedsDrawn_ = std::max(seedsDrawn, trees);
+	return model;
+}
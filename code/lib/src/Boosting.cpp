@@ -0,0 +1,217 @@
+#include <cmath>
+#include <future>
+#include "Boosting.hpp"
+
+using std::string;
+using Calculations::find_best_split;
+using Calculations::gradientSum;
+using Calculations::partition;
+
+namespace {
+	// hessians are kept away from 0 so that confident rows still bound the leaf values
+	constexpr double MinHessian = 1e-6;
+
+	// softmax of the scores in place, shifted by the maximum to avoid overflows
+	void softmax(double* scores, size_t classes) {
+		const double max = *std::max_element(scores, scores + classes);
+		double sum = 0;
+		for (size_t k = 0; k < classes; k++) {
+			scores[k] = std::exp(scores[k] - max);
+			sum += scores[k];
+		}
+		for (size_t k = 0; k < classes; k++)
+			scores[k] /= sum;
+	}
+}
+
+Boosting::Boosting(const DataReader& dr, const BoostingOptions& options) :
+	meta_(dr.metaData()),
+	options_(options),
+	baseScores_(),
+	trees_(),
+	trainingLoss_(),
+	trainingMetrics_(),
+	inferenceMetrics_() {
+	if (meta_.classNames.size() < 2)
+		throw std::runtime_error("Boosting needs at least two classes");
+	options_.threads = std::max<size_t>(1, options_.threads);
+	// loading and encoding happened in the DataReader
+	trainingMetrics_.phases.add(dr.metrics());
+	boost(dr.trainDataInt());
+}
+
+void Boosting::boost(const DataInt& data) {
+	const auto start = std::chrono::steady_clock::now();
+	const size_t classes = meta_.classNames.size();
+	const size_t rows = data.size();
+	const size_t decision_col = meta_.labels.size() - 1;
+	std::vector<VecI*> VecPtrVecI; // vector of pointers to every row, shared by all the trees
+
+	VecPtrVecI.reserve(rows);
+	for (size_t row = 0; row < rows; row++) {
+		VecPtrVecI.push_back(const_cast<VecI*>(&data[row]));
+	}
+
+	// start from the log of the class priors, smoothed so that no class starts at -inf
+	ClassCounts counts(classes, 0);
+	for (const auto& row : data)
+		counts[row[decision_col]]++;
+	for (size_t k = 0; k < classes; k++)
+		baseScores_.push_back(std::log((counts[k] + 1.0) / (rows + classes)));
+
+	std::vector<double> scores(rows * classes);
+	for (size_t row = 0; row < rows; row++)
+		std::copy(baseScores_.begin(), baseScores_.end(), scores.begin() + row * classes);
+
+	std::vector<Gradients> gradients(classes, Gradients(rows));
+	ThreadPool pool(std::min(options_.threads, classes));
+	trees_.reserve(options_.rounds * classes);
+	for (int round = 0; round < options_.rounds; round++) {
+		// gradient and hessian of the softmax log-loss: p_k - y_k and p_k (1 - p_k)
+		double loss = 0;
+		std::vector<double> p(classes);
+		for (size_t row = 0; row < rows; row++) {
+			std::copy(scores.begin() + row * classes, scores.begin() + (row + 1) * classes, p.begin());
+			softmax(p.data(), classes);
+			const int label = data[row][decision_col];
+			loss -= std::log(std::max(p[label], 1e-15));
+			for (size_t k = 0; k < classes; k++) {
+				gradients[k][row].grad = p[k] - (static_cast<int>(k) == label ? 1.0 : 0.0);
+				gradients[k][row].hess = std::max(p[k] * (1 - p[k]), MinHessian);
+			}
+		}
+		if (round > 0)
+			trainingLoss_.push_back(loss / rows);
+
+		// the class trees of a round only read the gradients and write their own score of every row
+		std::vector<TreeMetrics> metrics(classes);
+		std::vector<std::future<Node>> pending;
+		for (size_t k = 0; k < classes; k++) {
+			pending.push_back(pool.submit([this, k, &data, &gradients, &scores, &metrics, &VecPtrVecI]() {
+				const auto tree_start = std::chrono::steady_clock::now();
+				BuildContext context{ meta_, data, gradients[k], options_, scores, k, &metrics[k] };
+				Node root = buildTree(context, VecPtrVecI, 0);
+				metrics[k].wallNs.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tree_start).count());
+				return root;
+			}));
+		}
+		for (size_t k = 0; k < classes; k++) {
+			trees_.push_back(pending[k].get());
+			trainingMetrics_.phases.add(metrics[k].phases);
+			trainingMetrics_.trees.push_back(metrics[k]);
+		}
+	}
+
+	// log-loss of the final scores
+	double loss = 0;
+	std::vector<double> p(classes);
+	for (size_t row = 0; row < rows && options_.rounds > 0; row++) {
+		std::copy(scores.begin() + row * classes, scores.begin() + (row + 1) * classes, p.begin());
+		softmax(p.data(), classes);
+		loss -= std::log(std::max(p[data[row][decision_col]], 1e-15));
+	}
+	if (options_.rounds > 0)
+		trainingLoss_.push_back(loss / rows);
+	trainingMetrics_.wallNs.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+Node Boosting::buildTree(const BuildContext& context, const std::vector<VecI*>& VecPtrVecI, size_t depth) {
+	const BoostingOptions& options = context.options;
+	TreeMetrics* metrics = context.metrics;
+	std::tuple<double, Question> thesplit; // the split point
+	std::vector<VecI*> right_VecPtrVecI; // vector of pointers to the S1 dataset
+	std::vector<VecI*> left_VecPtrVecI; // vector of pointers to the S2 dataset
+
+	metrics->nodes.add(1);
+	// search a split while the depth limit allows it
+	if (depth < options.maxDepth && VecPtrVecI.size() > 1) {
+		ScopedPhase phase(&metrics->phases, Metrics::SplitSearch);
+		thesplit = find_best_split(VecPtrVecI, context.meta, context.data, context.gradients, options.lambda, options.minChildWeight);
+		metrics->rowsSorted.add(VecPtrVecI.size() * (context.meta.labels.size() - 1));
+	}
+
+	// no split reduces the loss, the leaf holds the shrunk Newton step of its rows
+	if (std::get<0>(thesplit) <= 0) {
+		ScopedPhase phase(&metrics->phases, Metrics::NodeConstruction);
+		metrics->recordLeaf(depth);
+		const GradientPair sum = gradientSum(VecPtrVecI, context.data, context.gradients);
+		const double value = -options.learningRate * sum.grad / (sum.hess + options.lambda);
+		// the rows of the leaf are known, their scores are updated without walking the tree again
+		const size_t classes = context.meta.classNames.size();
+		for (const VecI* row : VecPtrVecI)
+			context.scores[(row - context.data.data()) * classes + context.klass] += value;
+		return Node(Leaf(value));
+	}
+
+	{
+		ScopedPhase phase(&metrics->phases, Metrics::Partition);
+		auto thepartition = partition(VecPtrVecI, std::get<1>(thesplit), context.meta);
+		right_VecPtrVecI = std::move(std::get<0>(thepartition)); // true rows go on right S1
+		left_VecPtrVecI = std::move(std::get<1>(thepartition)); // false rows go on left S2
+	}
+	// the trees are shallow, both sides are built on the calling thread
+	Node right_node = buildTree(context, right_VecPtrVecI, depth + 1);
+	Node left_node = buildTree(context, left_VecPtrVecI, depth + 1);
+	ScopedPhase phase(&metrics->phases, Metrics::NodeConstruction);
+	return Node(right_node, left_node, std::get<1>(thesplit));
+}
+
+std::vector<double> Boosting::scores(const VecS& row) const {
+	TreeTest t;
+	uint64_t visits = 0;
+	const size_t classes = meta_.classNames.size();
+	std::vector<double> result(baseScores_);
+	for (size_t tree = 0; tree < trees_.size(); tree++) {
+		result[tree % classes] += t.classify(row, trees_[tree], DECISIONTREE_METRICS ? &visits : nullptr).value();
+	}
+	inferenceMetrics_.predictions.add(1);
+	inferenceMetrics_.nodeVisits.add(visits);
+	return result;
+}
+
+std::vector<double> Boosting::probabilities(const VecS& row) const {
+	std::vector<double> result = scores(row);
+	softmax(result.data(), result.size());
+	return result;
+}
+
+uint32_t Boosting::predictClass(const VecS& row) const {
+	const std::vector<double> result = scores(row);
+	return std::distance(result.begin(), std::max_element(result.begin(), result.end()));
+}
+
+std::string Boosting::predict(const VecS& row) const {
+	return meta_.classNames[predictClass(row)];
+}
+
+VecS Boosting::predict(const Data& rows, ThreadPool& pool) const {
+	VecS predictions(rows.size());
+	// every chunk writes to its own range of the output, no synchronisation is needed
+	pool.parallelFor(rows.size(), [this, &rows, &predictions](size_t begin, size_t end) {
+		for (size_t row = begin; row < end; row++) {
+			predictions[row] = predict(rows[row]);
+		}
+	}, 16);
+	return predictions;
+}
+
+double Boosting::accuracy(const Data& rows, ThreadPool& pool) const {
+	if (rows.empty())
+		return 0;
+	const VecS predictions = predict(rows, pool);
+	size_t correct = 0;
+	for (size_t row = 0; row < rows.size(); row++) {
+		if (predictions[row] == rows[row].back())
+			correct++;
+	}
+	return static_cast<double>(correct) / rows.size();
+}
+
+void Boosting::test(const Data& testData) const {
+	float accuracy = 0;
+	for (const auto& row : testData) {
+		if (predict(row) == row.back())
+			accuracy += 1;
+	}
+	std::cout << "Total accuracy: " << (accuracy / testData.size()) << std::endl;
+}
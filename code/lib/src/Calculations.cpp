@@ -1,6 +1,11 @@
+#include <array>
+#include <climits>
 #include <cmath>
 #include <algorithm>
+#include <future>
+#include <type_traits>
 #include <iterator>
+#include <random>
 #include "Calculations.hpp"
 #include "Utils.hpp"
 
@@ -12,79 +17,421 @@ using std::string;
 using std::unordered_map;
 
 
-// Partition the dataset in two subsets
-tuple<std::vector<VecI*>, std::vector<VecI*>> Calculations::partition(const std::vector<VecI*> VecPtrVecI, const Question& q, const MetaData& meta) {
-	std::vector<VecI*> true_rows; // vector for dataset S1
-	std::vector<VecI*> false_rows; // vector for dataset S2
-	int split_value; // the value spliting the dataset S
-
-	// check if the column is of ordinal type
-	if (meta.isnumeric[q.column_]) {
-		// initialize the best split value from the question q
-		split_value = stoi(q.value_);
-		// loop over all rows of data
-		for (size_t row = 0; row < VecPtrVecI.size(); row++) {
-			// if ordinal value is greater or equal than best split value, the row goes to true partition
-			if (VecPtrVecI[row]->at(q.column_) >= split_value) {
-				true_rows.push_back(VecPtrVecI[row]);
-			}
-			// if ordinal value is less than best split value, the row goes to false partition
-			else {
-				false_rows.push_back(VecPtrVecI[row]);
+namespace {
+	// run f(chunk, begin, end) on up to chunks contiguous ranges of [0, n) concurrently, the first range on the calling thread
+	template<class F>
+	void forChunks(size_t n, size_t chunks, F f) {
+		const size_t step = (n + chunks - 1) / std::max<size_t>(1, chunks);
+		std::vector<std::future<void>> pending;
+		for (size_t chunk = 1; chunk * step < n; chunk++) {
+			const size_t begin = chunk * step;
+			pending.push_back(std::async(std::launch::async, [&f, chunk, begin, end = std::min(n, begin + step)]() { f(chunk, begin, end); }));
+		}
+		f(size_t(0), size_t(0), std::min(n, step));
+		for (auto& p : pending)
+			p.get();
+	}
+
+	// sort the chunks concurrently, then merge neighbouring runs level by level
+	template<class T, class Less>
+	void parallelSort(std::vector<T>& values, size_t chunks, Less less) {
+		const size_t n = values.size();
+		if (chunks <= 1) {
+			std::sort(values.begin(), values.end(), less);
+			return;
+		}
+		forChunks(n, chunks, [&values, less](size_t, size_t begin, size_t end) { std::sort(values.begin() + begin, values.begin() + end, less); });
+		for (size_t width = (n + chunks - 1) / chunks; width < n; width *= 2) {
+			std::vector<std::future<void>> pending;
+			for (size_t begin = 0; begin + width < n; begin += 2 * width) {
+				pending.push_back(std::async(std::launch::async, [&values, less, begin, width, n]() {
+					std::inplace_merge(values.begin() + begin, values.begin() + begin + width, values.begin() + std::min(n, begin + 2 * width), less);
+				}));
 			}
+			for (auto& p : pending)
+				p.get();
+		}
+	}
+
+	// class counts of a node indexed by class id, a fixed size array for the common class count buckets
+	// so that the Gini updates below have a compile time trip count, a vector for the generic case
+	template<size_t Classes>
+	using Histogram = std::conditional_t<Classes == 0, vector<int>, std::array<int, Classes>>;
+
+	template<size_t Classes>
+	Histogram<Classes> makeHistogram(size_t classes) {
+		if constexpr (Classes == 0)
+			return vector<int>(classes, 0);
+		else
+			return Histogram<Classes>{};
+	}
+
+	// Gini impurity, the empty classes of a bucket contribute nothing
+	template<typename H>
+	double gini(const H& counts, double N) {
+		double impurity = 1.0;
+		for (int n : counts) {
+			const double p = n / N;
+			impurity -= p * p;
+		}
+		return impurity;
+	}
+
+	// the chunks count into histograms of their own which are summed afterwards
+	template<size_t Classes>
+	Histogram<Classes> classCounts(const std::vector<VecI*>& VecPtrVecI, size_t decision_col, size_t classes, size_t threads) {
+		std::vector<Histogram<Classes>> partial(threads, makeHistogram<Classes>(classes));
+		forChunks(VecPtrVecI.size(), threads, [&](size_t chunk, size_t begin, size_t end) {
+			Histogram<Classes>& counts = partial[chunk];
+			for (size_t row = begin; row < end; row++)
+				counts[(*VecPtrVecI[row])[decision_col]]++;
+		});
+		for (size_t chunk = 1; chunk < threads; chunk++) {
+			for (size_t k = 0; k < classes; k++)
+				partial[0][k] += partial[chunk][k];
 		}
+		return partial[0];
 	}
-	// column is of categorical type
-	else {
-		// initialize the best split value from the question q and map the string to its integer value
-		split_value = meta.mapS2I[q.column_].at(q.value_);
-		// loop over all rows of data
-		for (size_t row = 0; row < VecPtrVecI.size(); row++) {
-			// if categorical value is equal to best split value, the row goes to true partition
-			if (VecPtrVecI[row]->at(q.column_) == split_value) {
-				true_rows.push_back(VecPtrVecI[row]);
+
+	// Find the best threshold value in a numeric column with highest gain, specialised on the class bucket
+	template<size_t Classes>
+	tuple<int, double> numericThreshold(const std::vector<VecI*>& VecPtrVecI, int col, size_t decision_col, const Histogram<Classes>& decision_counts, double decision_gini, size_t threads) {
+		double best_gain = 0; // the best gain
+		int best_thresh = 0; // the column value representing the best threshold
+		const size_t max_rows = VecPtrVecI.size(); // number of rows in dataset S
+		const double total = static_cast<double>(max_rows); // total class count for S (decision column)
+		vector<pair<int, int>> mapValDec(max_rows); // mapping table between column value and decision value, used for quicker sorting
+
+		// every chunk gathers its own range of the table, the order of equal values does not change the gains
+		forChunks(max_rows, threads, [&](size_t, size_t begin, size_t end) {
+			for (size_t row = begin; row < end; row++) {
+				const VecI& values = *VecPtrVecI[row];
+				mapValDec[row] = { values[col], values[decision_col] };
 			}
-			// if categorical value is different to best split value, the row goes to false partition
-			else {
-				false_rows.push_back(VecPtrVecI[row]);
+		});
+		parallelSort(mapValDec, threads, [](const pair<int, int>& a, const pair<int, int>& b) { return a.first < b.first; });
+
+		// class counts of the rows holding a lower value than the next one and of the other rows
+		Histogram<Classes> value_counts = makeHistogram<Classes>(decision_counts.size());
+		Histogram<Classes> not_value_counts = decision_counts;
+		size_t total_value_count = 0; // total class count for S1
+		for (size_t row = 0; row < max_rows; row++) {
+			value_counts[mapValDec[row].second]++;
+			total_value_count++;
+			// evaluate the gain when the value changes, the last value is evaluated against itself
+			const bool last = row == max_rows - 1;
+			if (!last && mapValDec[row].first == mapValDec[row + 1].first)
+				continue;
+			const int next_value = last ? mapValDec[row].first : mapValDec[row + 1].first;
+			for (size_t k = 0; k < decision_counts.size(); k++)
+				not_value_counts[k] = decision_counts[k] - value_counts[k];
+			const double value_gini_score = gini(value_counts, total_value_count);
+			const double not_value_gini_score = gini(not_value_counts, total - total_value_count);
+			const double gain = decision_gini - ((total_value_count * value_gini_score) / total) - ((total - total_value_count) * not_value_gini_score / total);
+			if (gain > best_gain) {
+				best_gain = gain;
+				best_thresh = next_value;
 			}
 		}
+		return { best_thresh, best_gain };
 	}
-	return forward_as_tuple(true_rows, false_rows);
-}
 
-// Find the best split question and gain
-tuple<const double, const Question> Calculations::find_best_split(const std::vector<VecI*> VecPtrVecI, const MetaData& meta) {
-	double best_gain = 0.0;  // keep track of the best information gain
-	auto best_question = Question();  //keep track of the feature / value that produced it
-	tuple<std::string, double> curcolgain; // stores the best gain in the current column
-	ClassCounterInt decision_counts; // the class count of the decision column
-	double decision_gini_score; // the gini score of the dataset
+	// Gini impurity of counts held in a row of the category matrix below
+	template<size_t Classes>
+	double gini(const int* counts, size_t classes, double N) {
+		double impurity = 1.0;
+		for (size_t k = 0; k < (Classes > 0 ? Classes : classes); k++) {
+			const double p = counts[k] / N;
+			impurity -= p * p;
+		}
+		return impurity;
+	}
 
+	// buffers of the categorical kernel, every thread keeps its own across the columns and nodes it processes
+	// so that they only grow to the largest category domain instead of being allocated for every column
+	struct CategoricalScratch {
+		// category x class counts, row major with one row of stride counts per category
+		vector<int> counts{};
+		// class counts of the rows of the other categories
+		vector<int> rest{};
+	};
+	thread_local CategoricalScratch scratch;
 
-	// get the total counts from the decision column
-	decision_counts = classCounts(VecPtrVecI);
-	// compute the gini score for the dataset Gini(S)
-	decision_gini_score = gini(decision_counts, VecPtrVecI.size());
-	// loop through each column to find the best threshold of the column
-	for (size_t col = 0; col < (meta.labels.size() - 1); col++) {
-		curcolgain = determine_best_threshold(VecPtrVecI, col, meta.isnumeric[col], decision_counts, decision_gini_score);
-		// compare current column gain to best gain, if it is better store the column id, the question value and the information gain
-		if (std::get<1>(curcolgain) > best_gain) {
-			best_question.column_ = col;
-			best_gain = std::get<1>(curcolgain);
-			// if column is ordinal then we can directly store the string representing the ordinal
+	// Find the best category of a categorical column with highest gain: the class counts of every category are
+	// filled in one pass over the rows and every one-vs-rest question is scored from them and the node totals
+	template<size_t Classes>
+	tuple<int, double> categoricalThreshold(const std::vector<VecI*>& VecPtrVecI, int col, size_t categories, size_t decision_col, const Histogram<Classes>& decision_counts, double decision_gini, size_t threads) {
+		const size_t stride = decision_counts.size();
+		const size_t cells = categories * stride;
+		const double total = static_cast<double>(VecPtrVecI.size());
+		scratch.counts.assign(cells, 0);
+		scratch.rest.resize(stride);
+		int* counts = scratch.counts.data();
+
+		// the chunks run on threads of their own, they count in matrices summed afterwards
+		std::vector<vector<int>> partial(threads - 1);
+		forChunks(VecPtrVecI.size(), threads, [&](size_t chunk, size_t begin, size_t end) {
+			int* matrix = counts;
+			if (chunk > 0) {
+				partial[chunk - 1].assign(cells, 0);
+				matrix = partial[chunk - 1].data();
+			}
+			for (size_t row = begin; row < end; row++) {
+				const VecI& values = *VecPtrVecI[row];
+				matrix[values[col] * stride + values[decision_col]]++;
+			}
+		});
+		for (const auto& matrix : partial) {
+			for (size_t cell = 0; cell < matrix.size(); cell++)
+				counts[cell] += matrix[cell];
+		}
+
+		// the categories are scored in increasing order as the sorted sweep did, so ties keep the lowest category
+		double best_gain = 0;
+		int best_thresh = 0;
+		int* rest = scratch.rest.data();
+		for (size_t category = 0; category < categories; category++) {
+			const int* value_counts = counts + category * stride;
+			double value_total = 0;
+			for (size_t k = 0; k < stride; k++) {
+				value_total += value_counts[k];
+				rest[k] = decision_counts[k] - value_counts[k];
+			}
+			// categories missing from the node
+			if (value_total == 0)
+				continue;
+			const double gain = decision_gini - value_total * gini<Classes>(value_counts, stride, value_total) / total
+				- (total - value_total) * gini<Classes>(rest, stride, total - value_total) / total;
+			if (gain > best_gain) {
+				best_gain = gain;
+				best_thresh = static_cast<int>(category);
+			}
+		}
+		return { best_thresh, best_gain };
+	}
+
+	// the column kind is dispatched once per column of the node
+	template<size_t Classes>
+	tuple<int, double> bestThreshold(const std::vector<VecI*>& VecPtrVecI, int col, bool isnumeric, size_t categories, size_t decision_col, const Histogram<Classes>& decision_counts, double decision_gini, size_t threads) {
+		if (isnumeric)
+			return numericThreshold<Classes>(VecPtrVecI, col, decision_col, decision_counts, decision_gini, threads);
+		return categoricalThreshold<Classes>(VecPtrVecI, col, categories, decision_col, decision_counts, decision_gini, threads);
+	}
+
+	template<size_t Classes>
+	tuple<const double, const Question> findBestSplit(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, size_t threads) {
+		double best_gain = 0.0;  // keep track of the best information gain
+		auto best_question = Question();  //keep track of the feature / value that produced it
+		const size_t decision_col = meta.labels.size() - 1; // index of the decision column in the data table
+
+		// get the total counts from the decision column and the gini score for the dataset Gini(S)
+		const Histogram<Classes> decision_counts = classCounts<Classes>(VecPtrVecI, decision_col, meta.classNames.size(), threads);
+		const double decision_gini_score = gini(decision_counts, VecPtrVecI.size());
+		// loop through each column to find the best threshold of the column
+		for (size_t col = 0; col < decision_col; col++) {
+			const auto curcolgain = bestThreshold<Classes>(VecPtrVecI, col, meta.isnumeric[col], meta.mapI2S[col].size(), decision_col, decision_counts, decision_gini_score, threads);
+			// compare current column gain to best gain, if it is better store the column id, the question value and the information gain
+			if (std::get<1>(curcolgain) > best_gain) {
+				best_question.column_ = col;
+				best_gain = std::get<1>(curcolgain);
+				// if column is ordinal then we can directly store the string representing the ordinal
+				// if column is categorical we need to look back the original data string represented by the encoded value
+				// for example the value 7 could in fact represent the original string "R2D2" read in the dataset
+				if (meta.isnumeric[col])
+					best_question.value_ = std::to_string(std::get<0>(curcolgain));
+				else
+					best_question.value_ = meta.mapI2S[col].at(std::get<0>(curcolgain));
+			}
+		}
+		return forward_as_tuple(best_gain, best_question);
+	}
+
+	// Extra-Trees: one random question per column, the questions of all the columns are scored in a single
+	// pass over the rows instead of sorting every column
+	template<size_t Classes>
+	tuple<const double, const Question> findRandomSplit(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, uint64_t seed, size_t threads) {
+		const size_t decision_col = meta.labels.size() - 1; // index of the decision column in the data table
+		const size_t classes = meta.classNames.size();
+		const size_t max_rows = VecPtrVecI.size();
+
+		// range of the numeric columns and categories present in the categorical columns of the node, per chunk
+		struct Range {
+			int low = INT_MAX;
+			int high = INT_MIN;
+			std::vector<char> present{};
+		};
+		std::vector<std::vector<Range>> ranges(threads, std::vector<Range>(decision_col));
+		for (auto& chunk_ranges : ranges) {
+			for (size_t col = 0; col < decision_col; col++) {
+				if (!meta.isnumeric[col])
+					chunk_ranges[col].present.assign(meta.mapI2S[col].size(), 0);
+			}
+		}
+		forChunks(max_rows, threads, [&](size_t chunk, size_t begin, size_t end) {
+			std::vector<Range>& range = ranges[chunk];
+			for (size_t row = begin; row < end; row++) {
+				const VecI& values = *VecPtrVecI[row];
+				for (size_t col = 0; col < decision_col; col++) {
+					if (meta.isnumeric[col]) {
+						range[col].low = std::min(range[col].low, values[col]);
+						range[col].high = std::max(range[col].high, values[col]);
+					}
+					else {
+						range[col].present[values[col]] = 1;
+					}
+				}
+			}
+		});
+		for (size_t chunk = 1; chunk < threads; chunk++) {
+			for (size_t col = 0; col < decision_col; col++) {
+				Range& range = ranges[0][col];
+				range.low = std::min(range.low, ranges[chunk][col].low);
+				range.high = std::max(range.high, ranges[chunk][col].high);
+				for (size_t k = 0; k < range.present.size(); k++)
+					range.present[k] |= ranges[chunk][col].present[k];
+			}
+		}
+
+		// a threshold in (low, high] or a category among two present ones leaves rows on both sides,
+		// the columns holding a single value at the node have no candidate
+		std::mt19937_64 generator(seed);
+		std::vector<int> candidates(decision_col, 0);
+		std::vector<char> valid(decision_col, 0);
+		for (size_t col = 0; col < decision_col; col++) {
+			const Range& range = ranges[0][col];
 			if (meta.isnumeric[col]) {
-				best_question.value_ = std::get<0>(curcolgain);
+				if (range.low < range.high) {
+					candidates[col] = std::uniform_int_distribution<int>(range.low + 1, range.high)(generator);
+					valid[col] = 1;
+				}
+				continue;
 			}
-			// if column is categorical we need to look back the original data string represented by the current question string value
-			// for example the string value "7" could in fact represent the original string "R2D2" read in the dataset
-			else {
-				best_question.value_ = meta.mapI2S[col].at(stoi(std::get<0>(curcolgain)));
+			const int present = static_cast<int>(std::count(range.present.begin(), range.present.end(), 1));
+			if (present < 2)
+				continue;
+			int drawn = std::uniform_int_distribution<int>(0, present - 1)(generator);
+			for (size_t k = 0; k < range.present.size(); k++) {
+				if (range.present[k] && drawn-- == 0) {
+					candidates[col] = static_cast<int>(k);
+					break;
+				}
+			}
+			valid[col] = 1;
+		}
+
+		// class counts of the rows answering true for every column, and of all the rows of the node
+		std::vector<std::vector<Histogram<Classes>>> true_counts(threads, std::vector<Histogram<Classes>>(decision_col, makeHistogram<Classes>(classes)));
+		std::vector<Histogram<Classes>> decision_counts(threads, makeHistogram<Classes>(classes));
+		forChunks(max_rows, threads, [&](size_t chunk, size_t begin, size_t end) {
+			for (size_t row = begin; row < end; row++) {
+				const VecI& values = *VecPtrVecI[row];
+				const int decision = values[decision_col];
+				decision_counts[chunk][decision]++;
+				for (size_t col = 0; col < decision_col; col++) {
+					if (valid[col] && (meta.isnumeric[col] ? values[col] >= candidates[col] : values[col] == candidates[col]))
+						true_counts[chunk][col][decision]++;
+				}
+			}
+		});
+		for (size_t chunk = 1; chunk < threads; chunk++) {
+			for (size_t k = 0; k < classes; k++) {
+				decision_counts[0][k] += decision_counts[chunk][k];
+				for (size_t col = 0; col < decision_col; col++)
+					true_counts[0][col][k] += true_counts[chunk][col][k];
+			}
+		}
+
+		double best_gain = 0.0;
+		auto best_question = Question();
+		const double total = static_cast<double>(max_rows);
+		const double decision_gini = gini(decision_counts[0], total);
+		Histogram<Classes> false_counts = makeHistogram<Classes>(classes);
+		for (size_t col = 0; col < decision_col; col++) {
+			if (!valid[col])
+				continue;
+			const Histogram<Classes>& counts = true_counts[0][col];
+			double true_total = 0;
+			for (size_t k = 0; k < classes; k++) {
+				true_total += counts[k];
+				false_counts[k] = decision_counts[0][k] - counts[k];
+			}
+			const double gain = decision_gini - true_total * gini(counts, true_total) / total - (total - true_total) * gini(false_counts, total - true_total) / total;
+			if (gain > best_gain) {
+				best_gain = gain;
+				best_question.column_ = col;
+				best_question.value_ = meta.isnumeric[col] ? std::to_string(candidates[col]) : meta.mapI2S[col].at(candidates[col]);
 			}
 		}
+		return forward_as_tuple(best_gain, best_question);
 	}
-	return forward_as_tuple(best_gain, best_question);
+
+	// rows whose value passes the question go to the true partition, the others to the false partition
+	template<bool Numeric>
+	void partition(const std::vector<VecI*>& VecPtrVecI, size_t begin, size_t end, int col, int split_value, std::vector<VecI*>& true_rows, std::vector<VecI*>& false_rows) {
+		for (size_t row = begin; row < end; row++) {
+			const int value = (*VecPtrVecI[row])[col];
+			const bool is_true = Numeric ? value >= split_value : value == split_value;
+			(is_true ? true_rows : false_rows).push_back(VecPtrVecI[row]);
+		}
+	}
+
+	// the chunks partition their rows on their own, the partial partitions are appended in chunk order
+	// so that the rows keep the order of the sequential partition
+	template<bool Numeric>
+	void partition(const std::vector<VecI*>& VecPtrVecI, int col, int split_value, std::vector<VecI*>& true_rows, std::vector<VecI*>& false_rows, size_t threads) {
+		if (threads <= 1) {
+			partition<Numeric>(VecPtrVecI, 0, VecPtrVecI.size(), col, split_value, true_rows, false_rows);
+			return;
+		}
+		std::vector<std::vector<VecI*>> partial_true(threads), partial_false(threads);
+		forChunks(VecPtrVecI.size(), threads, [&](size_t chunk, size_t begin, size_t end) {
+			partition<Numeric>(VecPtrVecI, begin, end, col, split_value, partial_true[chunk], partial_false[chunk]);
+		});
+		for (size_t chunk = 0; chunk < threads; chunk++) {
+			true_rows.insert(true_rows.end(), partial_true[chunk].begin(), partial_true[chunk].end());
+			false_rows.insert(false_rows.end(), partial_false[chunk].begin(), partial_false[chunk].end());
+		}
+	}
+}
+
+// Partition the dataset in two subsets
+tuple<std::vector<VecI*>, std::vector<VecI*>> Calculations::partition(const std::vector<VecI*>& VecPtrVecI, const Question& q, const MetaData& meta, size_t threads) {
+	std::vector<VecI*> true_rows; // vector for dataset S1
+	std::vector<VecI*> false_rows; // vector for dataset S2
+
+	// ordinal values greater or equal than the split value go to the true partition,
+	// categorical values go there when they are equal to the encoded split value
+	if (meta.isnumeric[q.column_])
+		::partition<true>(VecPtrVecI, q.column_, stoi(q.value_), true_rows, false_rows, threads);
+	else
+		::partition<false>(VecPtrVecI, q.column_, meta.mapS2I[q.column_].at(q.value_), true_rows, false_rows, threads);
+	return forward_as_tuple(true_rows, false_rows);
+}
+
+// Find the best split question and gain, the kernels are specialised on the number of classes once per node
+tuple<const double, const Question> Calculations::find_best_split(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, size_t threads) {
+	const size_t classes = meta.classNames.size();
+	threads = std::max<size_t>(1, threads);
+	if (classes <= 2)
+		return findBestSplit<2>(VecPtrVecI, meta, threads);
+	if (classes <= 4)
+		return findBestSplit<4>(VecPtrVecI, meta, threads);
+	if (classes <= 8)
+		return findBestSplit<8>(VecPtrVecI, meta, threads);
+	return findBestSplit<0>(VecPtrVecI, meta, threads);
+}
+
+// Draw and score the random questions of the node, dispatched on the number of classes as find_best_split
+tuple<const double, const Question> Calculations::find_random_split(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, uint64_t seed, size_t threads) {
+	const size_t classes = meta.classNames.size();
+	threads = std::max<size_t>(1, threads);
+	if (classes <= 2)
+		return findRandomSplit<2>(VecPtrVecI, meta, seed, threads);
+	if (classes <= 4)
+		return findRandomSplit<4>(VecPtrVecI, meta, seed, threads);
+	if (classes <= 8)
+		return findRandomSplit<8>(VecPtrVecI, meta, seed, threads);
+	return findRandomSplit<0>(VecPtrVecI, meta, seed, threads);
 }
 
 // Calculates the Gini score based on the relative frequency of a class
@@ -97,87 +444,109 @@ const double Calculations::gini(const ClassCounterInt& counts, double N) {
 	return impurity;
 }
 
-// Find the best threshold value in one column with highest gain
+// Find the best threshold value in one column with highest gain, with the generic kernel as the class ids of the counter are not bounded
 tuple<std::string, double> Calculations::determine_best_threshold(const std::vector<VecI*> VecPtrVecI, int col, bool isnumeric, ClassCounterInt decision_counts, const double decision_gini) {
-	double best_gain = 0; // the best gain
-	double gain = 0; // the current value gain
-	double value_gini_score, not_value_gini_score; // gini scores for S1 and S2 datasets
-	std::string best_thresh; // the question value representing the best threshold
-	ClassCounterInt value_counts, not_value_counts; // class counters for S1 and S2 datasets
-	int current_value = 0; // current value being analysed
-	int next_value = 0; // next value , this is used to detect a change of value in the column and to trigger the gini and gain calculations
-	size_t total_value_count = 0; // total class count for S1
-	size_t total_decision_count = VecPtrVecI.size(); // total class count for S (decision column)
+	int classes = 0;
+	for (const auto& n : decision_counts)
+		classes = std::max(classes, n.first + 1);
+	Histogram<0> counts(classes, 0);
+	for (const auto& n : decision_counts)
+		counts[n.first] = n.second;
+	// without the meta data the category domain is bounded by the largest value of the column
+	size_t categories = 0;
+	for (const VecI* row : VecPtrVecI)
+		categories = std::max(categories, static_cast<size_t>((*row)[col]) + 1);
+	const auto thresh = bestThreshold<0>(VecPtrVecI, col, isnumeric, categories, VecPtrVecI[0]->size() - 1, counts, decision_gini, 1);
+	return forward_as_tuple(std::to_string(std::get<0>(thresh)), std::get<1>(thresh));
+}
+
+// Counts the total number of instances of each class in the decision column
+const ClassCounterInt Calculations::classCounts(const std::vector<VecI*> VecPtrVecI) {
+	ClassCounterInt decision_counts; // a class counter for dataset S
+	size_t max_rows = VecPtrVecI.size(); // number of rows in dataset S
 	size_t decision_col = VecPtrVecI[0]->size() - 1; // index of the decision column in the data table
-	size_t max_rows = total_decision_count; // number of rows in dataset S
-	vector<tuple<int, int>> mapValDec; // mapping table between column value and decision value, used for quicker sorting
-	bool calc_gain = false; // boolean trigger used to trigger the calculation of the gini and information gain
 
-	// Create a mapping table between the numerical value and its row number in the data table
-	// This is used to sort the column values instead of the big data table as it is quite faster
 	for (size_t row = 0; row < max_rows; row++) {
-		mapValDec.push_back(std::make_tuple(VecPtrVecI[row]->at(col), VecPtrVecI[row]->at(decision_col)));
+		decision_counts[VecPtrVecI[row]->at(decision_col)]++;
 	}
+	return decision_counts;
+}
 
-	// Sort ascending the mapping table based on the value of the column we look for the best threshold
-	std::sort(mapValDec.begin(), mapValDec.end(), [](tuple<int, int> a, tuple<int, int> b) { return std::get<0>(a) < std::get<0>(b); });
-
-	//initialize the current_value with the first value in the column, as it has been sorted ascending should be the smallest one
-	current_value = std::get<0>(mapValDec[0]);
+// Find the best split question and gain on the gradients of the rows
+tuple<const double, const Question> Calculations::find_best_split(const std::vector<VecI*>& VecPtrVecI, const MetaData& meta, const DataInt& data, const Gradients& gradients, double lambda, double minChildWeight) {
+	double best_gain = 0.0; // keep track of the best loss reduction
+	auto best_question = Question(); // keep track of the feature / value that produced it
+	const GradientPair total = gradientSum(VecPtrVecI, data, gradients); // the gradient sums of the dataset S
 
-	for (size_t row = 0; row < max_rows; row++) {
-		// increase the counters based on the decision column value
-		value_counts[std::get<1>(mapValDec[row])] += 1;
-		total_value_count++;
-		// while we are not at the last row compare current row value to the one in the next row to detect a change
-		if (row < (max_rows - 1)) {
-			// check if next value is the same, if not we need to calculate the gain for the current value
-			if (current_value != std::get<0>(mapValDec[row + 1])) {
-				calc_gain = true;
-				next_value = std::get<0>(mapValDec[row + 1]);
-			}
-		}
-		else {
-			// we are at the last row, we force the calculation of the gain for the last possible value
-			calc_gain = true;
-			next_value = current_value;
-		}
-		if (calc_gain) {
-			// The value in the sorted column changed, we need to calculate the gain for the previous value
-			value_gini_score = gini(value_counts, total_value_count);
-			// Calculate the gini score for the other values in this column 
-			not_value_counts = ClassCounterInt();
-			for (const auto& n : decision_counts) {
-				not_value_counts[n.first] = decision_counts[n.first] - value_counts[n.first];
-			}
-
-			not_value_gini_score = gini(not_value_counts, total_decision_count - total_value_count);
-			gain = decision_gini - ((total_value_count * value_gini_score) / total_decision_count) - (((total_decision_count - total_value_count)) * not_value_gini_score / total_decision_count);
-			if (gain > best_gain) {
-				best_gain = gain;
-				best_thresh = std::to_string(next_value);
+	// loop through each column to find the best threshold of the column
+	for (size_t col = 0; col < (meta.labels.size() - 1); col++) {
+		auto curcolgain = determine_best_threshold(VecPtrVecI, col, meta.isnumeric[col], data, gradients, total, lambda, minChildWeight);
+		if (std::get<1>(curcolgain) > best_gain) {
+			best_question.column_ = col;
+			best_gain = std::get<1>(curcolgain);
+			// categorical values are stored as their original string, as in the Gini split search
+			if (meta.isnumeric[col]) {
+				best_question.value_ = std::get<0>(curcolgain);
 			}
-			// If the column is categorical type reinitialize totals to count for next value in the sorted column
-			// For ordinal type we cumulate the totals throughout the table
-			if (isnumeric == false) {
-				value_counts = ClassCounterInt();
-				total_value_count = 0;
+			else {
+				best_question.value_ = meta.mapI2S[col].at(stoi(std::get<0>(curcolgain)));
 			}
-			current_value = next_value;
-			calc_gain = false;
 		}
 	}
-	return forward_as_tuple(best_thresh, best_gain);
+	return forward_as_tuple(best_gain, best_question);
 }
 
-// Counts the total number of instances of each class in the decision column
-const ClassCounterInt Calculations::classCounts(const std::vector<VecI*> VecPtrVecI) {
-	ClassCounterInt decision_counts; // a class counter for dataset S
-	size_t max_rows = VecPtrVecI.size(); // number of rows in dataset S
-	size_t decision_col = VecPtrVecI[0]->size() - 1; // index of the decision column in the data table
+// Find the threshold value in one column with the highest loss reduction
+tuple<std::string, double> Calculations::determine_best_threshold(const std::vector<VecI*>& VecPtrVecI, int col, bool isnumeric, const DataInt& data, const Gradients& gradients, const GradientPair& total, double lambda, double minChildWeight) {
+	double best_gain = 0; // the best gain
+	std::string best_thresh; // the question value representing the best threshold
+	const size_t max_rows = VecPtrVecI.size(); // number of rows in dataset S
+	vector<pair<int, size_t>> mapValRow; // mapping table between column value and row position in the data table
+	auto score = [lambda](const GradientPair& g) { return g.grad * g.grad / (g.hess + lambda); };
+	const double parent_score = score(total);
 
+	mapValRow.reserve(max_rows);
 	for (size_t row = 0; row < max_rows; row++) {
-		decision_counts[VecPtrVecI[row]->at(decision_col)]++;
+		mapValRow.emplace_back(VecPtrVecI[row]->at(col), VecPtrVecI[row] - data.data());
 	}
-	return decision_counts;
+	std::sort(mapValRow.begin(), mapValRow.end(), [](const pair<int, size_t>& a, const pair<int, size_t>& b) { return a.first < b.first; });
+
+	// the sums of the rows holding the value (categorical) or a lower value (numeric), which go to the false branch
+	// of a numeric question and to the true branch of a categorical one
+	GradientPair value_sum;
+	for (size_t row = 0; row < max_rows; row++) {
+		const GradientPair& g = gradients[mapValRow[row].second];
+		value_sum.grad += g.grad;
+		value_sum.hess += g.hess;
+		// evaluate a split when the value changes, the last value of a numeric column leaves no row on the true side
+		const bool last = row == max_rows - 1;
+		if (!last && mapValRow[row].first == mapValRow[row + 1].first)
+			continue;
+		if (!(isnumeric && last)) {
+			const GradientPair other{ total.grad - value_sum.grad, total.hess - value_sum.hess };
+			if (value_sum.hess >= minChildWeight && other.hess >= minChildWeight) {
+				const double gain = 0.5 * (score(value_sum) + score(other) - parent_score);
+				if (gain > best_gain) {
+					best_gain = gain;
+					// numeric questions ask for values greater or equal than the next value in the column
+					best_thresh = std::to_string(isnumeric ? mapValRow[row + 1].first : mapValRow[row].first);
+				}
+			}
+		}
+		// categorical sums are per value, ordinal sums are cumulated throughout the table
+		if (!isnumeric)
+			value_sum = GradientPair();
+	}
+	return forward_as_tuple(best_thresh, best_gain);
+}
+
+// Sums the gradients and hessians of the rows in dataset S
+const GradientPair Calculations::gradientSum(const std::vector<VecI*>& VecPtrVecI, const DataInt& data, const Gradients& gradients) {
+	GradientPair total;
+	for (const VecI* row : VecPtrVecI) {
+		const GradientPair& g = gradients[row - data.data()];
+		total.grad += g.grad;
+		total.hess += g.hess;
+	}
+	return total;
 }
@@ -0,0 +1,169 @@
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include "Compaction.hpp"
+#include "Memory.hpp"
+
+using std::string;
+
+namespace {
+	// 64 bit FNV-1a step, as the prediction cache keys
+	inline uint64_t mix(uint64_t hash, uint64_t value) {
+		return (hash ^ value) * 1099511628211ULL;
+	}
+
+	// a subtree by its question and the ids of its distinct branches, or a leaf by its class counts and score
+	struct Key {
+		int column = -1;
+		string value{};
+		uint32_t trueId = 0;
+		uint32_t falseId = 0;
+		ClassCounts counts{};
+		uint64_t score = 0;
+
+		bool operator==(const Key& other) const {
+			return column == other.column && trueId == other.trueId && falseId == other.falseId
+				&& score == other.score && value == other.value && counts == other.counts;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			uint64_t hash = 14695981039346656037ULL;
+			hash = mix(hash, static_cast<uint32_t>(key.column));
+			hash = mix(hash, std::hash<string>()(key.value));
+			hash = mix(hash, key.trueId);
+			hash = mix(hash, key.falseId);
+			hash = mix(hash, key.score);
+			for (uint32_t count : key.counts)
+				hash = mix(hash, count);
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	class Pool {
+	public:
+		Pool() : ids_(), nodes_(), reached_(0) {}
+
+		// the id of the distinct subtree of the node, children first
+		uint32_t intern(const Node& root) {
+			// (node, children interned)
+			std::vector<std::pair<const Node*, bool>> stack{ { &root, false } };
+			std::vector<uint32_t> ids;
+			while (!stack.empty()) {
+				auto [node, expanded] = stack.back();
+				stack.pop_back();
+				if (const Leaf* leaf = node->leaf().get(); leaf != nullptr) {
+					reached_++;
+					Key key;
+					key.counts = leaf->counts();
+					// the raw score of a regression leaf, by its bits
+					const double score = leaf->value();
+					std::memcpy(&key.score, &score, sizeof(score));
+					ids.push_back(find(key, *node, true));
+					continue;
+				}
+				if (!expanded) {
+					stack.emplace_back(node, true);
+					stack.emplace_back(node->falseBranch().get(), false);
+					stack.emplace_back(node->trueBranch().get(), false);
+					continue;
+				}
+				// the true branch was interned before the false branch
+				reached_++;
+				Key key;
+				key.column = node->question().column_;
+				key.value = node->question().value_;
+				key.falseId = ids.back();
+				ids.pop_back();
+				key.trueId = ids.back();
+				ids.pop_back();
+				ids.push_back(find(key, *node, false));
+			}
+			return ids.back();
+		}
+
+		inline const Node& node(uint32_t id) const { return *nodes_[id]; }
+		inline size_t reached() const { return reached_; }
+
+	private:
+		std::unordered_map<Key, uint32_t, KeyHash> ids_;
+		// the shared representation of every distinct subtree
+		std::vector<std::shared_ptr<const Node>> nodes_;
+		size_t reached_;
+
+		uint32_t find(const Key& key, const Node& node, bool leaf) {
+			if (const auto it = ids_.find(key); it != ids_.end())
+				return it->second;
+			const uint32_t id = static_cast<uint32_t>(nodes_.size());
+			// a copy of a leaf node shares its Leaf, a new inner node links the shared nodes of its branches
+			if (leaf)
+				nodes_.push_back(std::make_shared<const Node>(node));
+			else
+				nodes_.push_back(std::make_shared<const Node>(nodes_[key.trueId], nodes_[key.falseId], node.question()));
+			ids_.emplace(key, id);
+			return id;
+		}
+	};
+
+	size_t totalBytes(const std::vector<Node>& roots) {
+		const std::vector<size_t> bytes = Memory::forestBytes(roots);
+		return std::accumulate(bytes.begin(), bytes.end(), size_t(0));
+	}
+
+	// the Node and Leaf objects of the trees, every shared object once and every root as one object of its own
+	std::pair<size_t, size_t> countObjects(const std::vector<Node>& roots) {
+		std::unordered_set<const Node*> nodes;
+		std::unordered_set<const Leaf*> leaves;
+		std::vector<const Node*> stack;
+		for (const auto& root : roots) {
+			stack.push_back(&root);
+			while (!stack.empty()) {
+				const Node* node = stack.back();
+				stack.pop_back();
+				if (const Leaf* leaf = node->leaf().get(); leaf != nullptr) {
+					leaves.insert(leaf);
+					continue;
+				}
+				for (const Node* child : { node->trueBranch().get(), node->falseBranch().get() }) {
+					if (nodes.insert(child).second)
+						stack.push_back(child);
+				}
+			}
+		}
+		return { nodes.size() + roots.size(), leaves.size() };
+	}
+}
+
+CompactionReport Compaction::compact(std::vector<Node>& roots) {
+	CompactionReport report;
+	report.trees = roots.size();
+	report.bytesBefore = totalBytes(roots);
+	Pool pool;
+	std::vector<uint32_t> ids;
+	for (const auto& root : roots)
+		ids.push_back(pool.intern(root));
+	// the roots are copies of the shared subtrees, they share their branches
+	for (size_t i = 0; i < roots.size(); i++)
+		roots[i] = pool.node(ids[i]);
+	report.nodes = pool.reached();
+	std::tie(report.distinctNodes, report.distinctLeaves) = countObjects(roots);
+	report.bytesAfter = totalBytes(roots);
+	return report;
+}
+
+string CompactionReport::toJson() const {
+	std::ostringstream json;
+	json << "{\"trees\": " << trees
+		<< ", \"nodes\": " << nodes
+		<< ", \"distinct_nodes\": " << distinctNodes
+		<< ", \"distinct_leaves\": " << distinctLeaves
+		<< ", \"ratio\": " << ratio()
+		<< ", \"bytes_before\": " << bytesBefore
+		<< ", \"bytes_after\": " << bytesAfter << "}";
+	return json.str();
+}
@@ -2,38 +2,67 @@
 #include "DataReader.hpp"
 
 using boost::algorithm::split;
-using boost::timer::cpu_timer;
 
 DataReader::DataReader(const Dataset& dataset) :
 	classLabel_(dataset.classLabel),
-	trainData_({}),
-	testData_({}),
+	trainData_(),
+	testData_(),
 	trainMetaData_({}),
-	testMetaData_({}) {
-	std::cout << "Start reading data set." << std::endl; cpu_timer timer;
-	std::thread readTestingData([this, &dataset]() {
-		return processFile(dataset.train.filename, trainData_, trainMetaData_);
+	testMetaData_({}),
+	trainDataInt_(std::make_shared<const DataInt>()),
+	metrics_() {
+	// the tables are filled here and only shared once they are complete
+	auto trainData = std::make_shared<Data>();
+	auto testData = std::make_shared<Data>();
+	std::thread readTestingData([this, &dataset, &trainData]() {
+		ScopedPhase phase(&metrics_, Metrics::Load);
+		return processFile(dataset.train.filename, *trainData, trainMetaData_);
 		});
 
-	std::thread readTrainingData([this, &dataset]() {
-		return processFile(dataset.test.filename, testData_, testMetaData_);
+	std::thread readTrainingData([this, &dataset, &testData]() {
+		ScopedPhase phase(&metrics_, Metrics::Load);
+		return processFile(dataset.test.filename, *testData, testMetaData_);
 		});
 
 	readTrainingData.join();
 	readTestingData.join();
-	std::cout << "Done. " << timer.format() << std::endl;
+	trainData_ = trainData;
+	testData_ = testData;
 
 	if (!classLabel_.empty())
 		moveClassLabelToBack();
 
-	if (trainData_.empty())
+	if (trainData_->empty())
 		throw std::runtime_error("Can't open file: " + dataset.train.filename);
 
-	if (testData_.empty())
+	if (testData_->empty())
 		throw std::runtime_error("Can't open file: " + dataset.test.filename);
 
+	if (trainMetaData_.isnumeric.back())
+		throw std::runtime_error("The class column must be nominal: " + trainMetaData_.labels.back());
+
+	// intern the class names once, indexed by the class id used in trainDataInt
+	const auto& classMap = trainMetaData_.mapI2S.back();
+	trainMetaData_.classNames.resize(classMap.size());
+	for (const auto& [id, name] : classMap)
+		trainMetaData_.classNames[id] = name;
+
 	// fill in trainDataInt table with the trainData information converted to int format
-	InitializeDataInt(trainData_, trainMetaData_);
+	{
+		ScopedPhase phase(&metrics_, Metrics::Encode);
+		InitializeDataInt(*trainData_, trainMetaData_);
+	}
+	// the trees only read the int table, the strings are only needed to score the training rows
+	if (!dataset.keepTrainStrings)
+		trainData_ = std::make_shared<const Data>();
+}
+
+DataMemory DataReader::memoryUsage() const {
+	DataMemory usage;
+	usage.trainStrings = Memory::bytes(*trainData_);
+	usage.testStrings = Memory::bytes(*testData_);
+	usage.trainInt = Memory::bytes(*trainDataInt_);
+	return usage;
 }
 
 void DataReader::processFile(const std::string& filename, Data& data, MetaData& meta) {
@@ -125,7 +154,9 @@ bool DataReader::parseHeaderLine(const std::string& line, MetaData& meta, bool&
 			// remove white spaces
 			trimWhiteSpaces(vec_values);
 			s = s.substr(0, pos);
-			meta.labels.push_back(s); 
+			// trim now, the class label is looked up in the labels while the data lines are parsed
+			boost::trim(s);
+			meta.labels.push_back(s);
 			// initialize additional metadata
 			meta.isnumeric.push_back(false); // column information is of categorical type
 			// create a mapping table from string value to int value
@@ -186,8 +217,17 @@ bool DataReader::parseDataLine(const std::string& line, Data& data, MetaData& me
 
 void DataReader::moveClassLabelToBack() {
 	const auto result = std::find(std::begin(trainMetaData_.labels), std::end(trainMetaData_.labels), classLabel_);
-	if (result != std::end(metaData().labels))
+	if (result != std::end(metaData().labels)) {
+		const size_t index = std::distance(std::begin(trainMetaData_.labels), result);
+		const size_t last = trainMetaData_.labels.size() - 1;
 		std::iter_swap(result, std::end(trainMetaData_.labels) - 1);
+		// the other column descriptions have to follow the label, as the data rows were swapped while parsing
+		const bool isnumeric = trainMetaData_.isnumeric[index];
+		trainMetaData_.isnumeric[index] = trainMetaData_.isnumeric[last];
+		trainMetaData_.isnumeric[last] = isnumeric;
+		std::swap(trainMetaData_.mapS2I[index], trainMetaData_.mapS2I[last]);
+		std::swap(trainMetaData_.mapI2S[index], trainMetaData_.mapI2S[last]);
+	}
 }
 
 void DataReader::moveClassDataToBack(VecS& line, const VecS& labels) const {
@@ -204,17 +244,18 @@ void DataReader::trimWhiteSpaces(VecS& line) {
 }
 
 // Function to convert trainData from std::vector<std::vector<std::string>> to std::vector<std::vector<int>>
-void DataReader::InitializeDataInt(Data& data, const MetaData& meta) {
+void DataReader::InitializeDataInt(const Data& data, const MetaData& meta) {
 	VecI empty_row; // An empty vector of int, used as a placeholder to generate the empty table
-	// Initialize the empty table of DataInt based on the size of data and the number of columns
-	trainDataInt_.clear();
+	// a new table replaces the one of the reader, which may be shared with copies of the reader
+	auto table = std::make_shared<DataInt>();
+	DataInt& trainDataInt = *table;
 	// Reserve in memory a vector of capacity to hold all the rows 
-	trainDataInt_.reserve(data.size());
+	trainDataInt.reserve(data.size());
 	// Reserve the empty vector of int to be able to hold information of all columns 
 	empty_row.resize(meta.labels.size());
 	// Push the empty row to the table as many times as there are data rows
 	for (size_t row = 0; row < data.size(); row++) {
-		trainDataInt_.push_back(empty_row);
+		trainDataInt.push_back(empty_row);
 	}
 	// Now fill in the trainDataInt table with the trainData information converted to int format
 	for (size_t col = 0; col < meta.labels.size(); col++) {
@@ -222,7 +263,7 @@ void DataReader::InitializeDataInt(Data& data, const MetaData& meta) {
 		if (meta.isnumeric.at(col)) {
 			for (size_t row = 0; row < data.size(); row++) {
 				// the string representing a number is converted to an int
-				trainDataInt_[row].at(col) = stoi(data[row].at(col));
+				trainDataInt[row].at(col) = stoi(data[row].at(col));
 			}
 		}
 		else {
@@ -231,8 +272,9 @@ void DataReader::InitializeDataInt(Data& data, const MetaData& meta) {
 				// this is based on mappings saved in the MetaData and read from the attribute possible values enumeration
 				// example from tennis.arff file : @attribute outlook { Sunny, Overcast, Rain } 
 				// would map : Sunny to 0, Overcast to 1 and Rain to 2
-				trainDataInt_[row].at(col) = meta.mapS2I[col].at(data[row].at(col));
+				trainDataInt[row].at(col) = meta.mapS2I[col].at(data[row].at(col));
 			}
 		}
 	}
+	trainDataInt_ = table;
 }
@@ -1,19 +1,31 @@
 #include "DecisionTree.hpp"
-#include <future>
+#include <algorithm>
 #include <chrono>
+#include <functional>
+#include <future>
 
 
 using std::make_shared;
 using std::shared_ptr;
 using std::string;
-using boost::timer::cpu_timer;
 using Calculations::find_best_split;
+using Calculations::find_random_split;
 using Calculations::partition;
 using std::tuple;
 using std::future;
 
+namespace {
+	// seed of a child node, a splitmix64 step of the seed of its parent and of the side of the child
+	uint64_t childSeed(uint64_t seed, bool trueBranch) {
+		uint64_t z = seed + (trueBranch ? 0x9e3779b97f4a7c15ULL : 0x3c6ef372fe94f82aULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+}
 
-DecisionTree::DecisionTree(const DataReader& dr) : root_(Node()), dr_(dr) {
+
+DecisionTree::DecisionTree(const DataReader& dr) : root_(Node()), dr_(dr), metrics_() {
 	std::vector<VecI*> VecPtrVecI; // vector of pointers to vectors of int
 	DataInt* ptrtheTable; // pointer to the DataInt dataset
 
@@ -23,14 +35,15 @@ DecisionTree::DecisionTree(const DataReader& dr) : root_(Node()), dr_(dr) {
 	for (size_t row = 0; row < ptrtheTable->size(); row++) {
 		VecPtrVecI.push_back(&ptrtheTable->at(row));
 	}
-	cpu_timer timer;
+	const auto start = std::chrono::steady_clock::now();
 	// build the tree
-	root_ = buildTree(dr.metaData(), VecPtrVecI);
-	std::cout << "Done. " << timer.format() << std::endl;
+	const TreeOptions options;
+	root_ = buildTree(BuildContext{ dr.metaData(), options, &metrics_, nullptr }, VecPtrVecI, 0, options.seed);
+	metrics_.wallNs.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
 }
 
 
-DecisionTree::DecisionTree(DataReader& dr, DataInt& bootstrap_int) : root_(Node()), dr_(dr) {
+DecisionTree::DecisionTree(const DataReader& dr, const DataInt& bootstrap_int, MemoryTracker* memory, const TreeOptions& options) : root_(Node()), dr_(dr), metrics_() {
 	std::vector<VecI*> VecPtrVecI; // vector of pointers to vectors of int
 	DataInt* ptrtheTable; // pointer to the DataInt dataset
 
@@ -40,14 +53,24 @@ DecisionTree::DecisionTree(DataReader& dr, DataInt& bootstrap_int) : root_(Node(
 	for (size_t row = 0; row < ptrtheTable->size(); row++) {
 		VecPtrVecI.push_back(&ptrtheTable->at(row));
 	}
-	cpu_timer timer;
+	const auto start = std::chrono::steady_clock::now();
 	// build the tree
-	root_ = buildTree(dr.metaData(), VecPtrVecI);
-	std::cout << "Done. " << timer.format() << std::endl;
+	root_ = buildTree(BuildContext{ dr.metaData(), options, &metrics_, memory }, VecPtrVecI, 0, options.seed);
+	metrics_.wallNs.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
 }
 
 
-Node DecisionTree::buildTree(const MetaData& meta, const std::vector<std::vector<int>*> VecPtrVecI) {
+DecisionTree::DecisionTree(const DataReader& dr, const std::vector<VecI*>& rows, const TreeOptions& options, MemoryTracker* memory) : root_(Node()), dr_(dr), metrics_() {
+	const auto start = std::chrono::steady_clock::now();
+	// build the tree, the rows are only read through the pointers
+	root_ = buildTree(BuildContext{ dr.metaData(), options, &metrics_, memory }, rows, 0, options.seed);
+	metrics_.wallNs.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+
+Node DecisionTree::buildTree(const BuildContext& context, const std::vector<std::vector<int>*>& VecPtrVecI, size_t depth, uint64_t seed) {
+	const MetaData& meta = context.meta;
+	TreeMetrics* metrics = context.metrics;
 	tuple< double, Question> thesplit; // the split point
 	double thegain; // the gain returned at thes plit point 
 	Node left_node, right_node; // pointers to left and right nodes
@@ -59,35 +82,59 @@ Node DecisionTree::buildTree(const MetaData& meta, const std::vector<std::vector
 	size_t decision_col = meta.labels.size() - 1; // index of the decision column
 	
 	// Find the best split in the dataset S and retrieve the information gain and the split question
-	thesplit = find_best_split(VecPtrVecI, meta);
+	// nodes at the depth limit or with too few rows become leaves without searching a split
+	const TreeOptions& options = context.options;
+	// the first levels hold most of the rows, their nodes are processed by several threads
+	const size_t row_threads = options.parallelRows > 0 && VecPtrVecI.size() >= options.parallelRows ? std::max<size_t>(1, options.rowThreads) : 1;
+	if (row_threads > 1)
+		metrics->rowParallelNodes.add(1);
+	if ((options.maxDepth == 0 || depth < options.maxDepth) && VecPtrVecI.size() >= options.minRowsSplit) {
+		ScopedPhase phase(&metrics->phases, Metrics::SplitSearch);
+		if (options.extraTrees) {
+			thesplit = find_random_split(VecPtrVecI, meta, seed, row_threads);
+		}
+		else {
+			thesplit = find_best_split(VecPtrVecI, meta, row_threads);
+			// every numeric column of the node is sorted once by the split search, the categorical ones are counted
+			metrics->rowsSorted.add(VecPtrVecI.size() * std::count(meta.isnumeric.begin(), meta.isnumeric.begin() + decision_col, true));
+		}
+	}
+	metrics->nodes.add(1);
 	thegain = std::get<0>(thesplit);
 	thequestion = std::get<1>(thesplit);
 
 	// check if the information gain is null then we are on a Leaf Node
 	if (thegain == 0) {
-		ClassCounter value_counts;
-		size_t total_value_count = 0;
-		// count the class counts in the decision column
+		ScopedPhase phase(&metrics->phases, Metrics::NodeConstruction);
+		metrics->recordLeaf(depth);
+		// count the class ids in the decision column, the class names are interned in the meta data
+		ClassCounts value_counts(meta.classNames.size(), 0);
 		for (size_t row = 0; row < VecPtrVecI.size(); row++) {
-			string str_leaf = meta.mapI2S[decision_col].at(VecPtrVecI[row]->at(decision_col));
-			value_counts[str_leaf] += 1;
-			total_value_count++;
+			value_counts[(*VecPtrVecI[row])[decision_col]] += 1;
 		}
-		return Node(Leaf(value_counts)); // return a Leaf Node
+		return Node(Leaf(std::move(value_counts))); // return a Leaf Node
 	} 
 	// when gain is not null we can partition further down the decision tree
 	else { 
+		// the partitions live until both subtrees are built, at most twice the node rows are needed as the vectors grow
+		MemoryReservation reservation(context.memory, 2 * Memory::bytes(VecPtrVecI), "the row partitions of a node");
 		// split the dataset S in two sets S1 and S2
-		thepartition = partition(VecPtrVecI, thequestion, meta);
-		right_VecPtrVecI = std::get<0>(thepartition); // true rows go on right S1
-		left_VecPtrVecI = std::get<1>(thepartition); // false rows go on left S2
+		{
+			ScopedPhase phase(&metrics->phases, Metrics::Partition);
+			thepartition = partition(VecPtrVecI, thequestion, meta, row_threads);
+			right_VecPtrVecI = std::move(std::get<0>(thepartition)); // true rows go on right S1
+			left_VecPtrVecI = std::move(std::get<1>(thepartition)); // false rows go on left S2
+		}
+		reservation.shrink(Memory::bytes(right_VecPtrVecI) + Memory::bytes(left_VecPtrVecI));
 		// we only start threads if there are more than 25000 rows in the current dataset S before the split
 		// this value has been found by testing on the university servers to be efficient to prevent 
 		// the cpu overhead of starting threads for small datasets
 		if (VecPtrVecI.size() > 25000) {
 			// start two asynchronous threads for each side of the decision tree
-			right_future = std::async(std::launch::async, buildTree, meta, right_VecPtrVecI);
-			left_future = std::async(std::launch::async, buildTree, meta, left_VecPtrVecI);
+			// the arguments are passed by reference as they outlive both threads
+			right_future = std::async(std::launch::async, buildTree, std::cref(context), std::cref(right_VecPtrVecI), depth + 1, childSeed(seed, true));
+			left_future = std::async(std::launch::async, buildTree, std::cref(context), std::cref(left_VecPtrVecI), depth + 1, childSeed(seed, false));
+			metrics->threadsSpawned.add(2);
 			// retrieve the results of both threads 
 			right_node = right_future.get();
 			left_node = left_future.get();
@@ -96,9 +143,10 @@ Node DecisionTree::buildTree(const MetaData& meta, const std::vector<std::vector
 		// of the decision tree in sequential order as it is too costly to start new threads
 		else
 		{
-			right_node = buildTree(meta, right_VecPtrVecI);
-			left_node = buildTree(meta, left_VecPtrVecI);
+			right_node = buildTree(context, right_VecPtrVecI, depth + 1, childSeed(seed, true));
+			left_node = buildTree(context, left_VecPtrVecI, depth + 1, childSeed(seed, false));
 		}
+		ScopedPhase phase(&metrics->phases, Metrics::NodeConstruction);
 		return Node(right_node, left_node, thequestion); // return a full Node with pointers to left and right nodes and the split question
 	}
 }
@@ -110,7 +158,7 @@ void DecisionTree::print() const {
 void DecisionTree::print(const shared_ptr<Node> root, string spacing) const {
 	if (bool is_leaf = root->leaf() != nullptr; is_leaf) {
 		const auto& leaf = root->leaf();
-		std::cout << spacing + "Predict: "; Utils::print::print_map(leaf->predictions());
+		std::cout << spacing + "Predict: "; Utils::print::print_map(leaf->predictions(dr_.metaData().classNames));
 		return;
 	}
 	std::cout << spacing << root->question().toString(dr_.metaData().labels) << "\n";
@@ -0,0 +1,161 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Distributed.hpp"
+
+using std::string;
+
+namespace {
+	// writes the whole buffer to the file descriptor, returns false on an error
+	bool writeAll(int fd, const string& buffer) {
+		size_t written = 0;
+		while (written < buffer.size()) {
+			ssize_t n = ::write(fd, buffer.data() + written, buffer.size() - written);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return false;
+			written += n;
+		}
+		return true;
+	}
+
+	// body of a forked worker, it never returns
+	[[noreturn]] void runWorker(int fd, const DataReader& dr, const BaggingOptions& options, size_t begin, size_t end) {
+		int status = 0;
+		try {
+			std::ostringstream out;
+			Bagging::trainSlice(dr, options, begin, end, out);
+			if (!writeAll(fd, out.str()))
+				status = 1;
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Worker for trees " << begin << " to " << end << " failed: " << e.what() << std::endl;
+			status = 1;
+		}
+		::close(fd);
+		// skip the destructors and exit handlers of the coordinator's copy of the process
+		::_exit(status);
+	}
+}
+
+std::vector<std::pair<size_t, size_t>> Distributed::slices(size_t trees, size_t workers) {
+	std::vector<std::pair<size_t, size_t>> result;
+	workers = std::max<size_t>(1, std::min(workers, trees));
+	size_t begin = 0;
+	for (size_t worker = 0; worker < workers; worker++) {
+		// the first trees % workers slices get one tree more
+		size_t end = begin + trees / workers + (worker < trees % workers ? 1 : 0);
+		result.emplace_back(begin, end);
+		begin = end;
+	}
+	return result;
+}
+
+Bagging Distributed::train(const DataReader& dr, const BaggingOptions& options, size_t workers) {
+	// the trees kept depend on the signal of every earlier tree, which the slices do not see
+	if (options.earlyStopping.patience > 0)
+		throw std::invalid_argument("Early stopping is not supported by the distributed training");
+	// the trees built within a budget depend on the time the other trees took
+	if (options.timeBudget > 0)
+		throw std::invalid_argument("A time budget is not supported by the distributed training");
+	const auto ranges = slices(options.ensembleSize, workers);
+	BaggingOptions worker_options = options;
+	worker_options.threads = std::max<size_t>(1, options.threads / ranges.size());
+
+	std::vector<pid_t> pids;
+	std::vector<int> fds;
+	for (const auto& [begin, end] : ranges) {
+		int pipe_fds[2];
+		if (::pipe(pipe_fds) != 0)
+			throw std::runtime_error("Can't create pipe: " + string(std::strerror(errno)));
+		// flush before forking so that buffered output is not written twice
+		std::cout.flush();
+		std::cerr.flush();
+		pid_t pid = ::fork();
+		if (pid < 0)
+			throw std::runtime_error("Can't start worker: " + string(std::strerror(errno)));
+		if (pid == 0) {
+			::close(pipe_fds[0]);
+			// the pipes of the earlier workers belong to the coordinator
+			for (int fd : fds)
+				::close(fd);
+			runWorker(pipe_fds[1], dr, worker_options, begin, end);
+		}
+		::close(pipe_fds[1]);
+		pids.push_back(pid);
+		fds.push_back(pipe_fds[0]);
+	}
+
+	// read all the pipes at once, a worker blocked on a full pipe must not wait for the others
+	std::vector<string> outputs(fds.size());
+	std::vector<pollfd> polled;
+	for (int fd : fds)
+		polled.push_back(pollfd{ fd, POLLIN, 0 });
+	size_t open = fds.size();
+	char buffer[1 << 16];
+	while (open > 0) {
+		if (::poll(polled.data(), polled.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			throw std::runtime_error("Can't read from workers: " + string(std::strerror(errno)));
+		}
+		for (size_t i = 0; i < polled.size(); i++) {
+			if (polled[i].fd < 0 || polled[i].revents == 0)
+				continue;
+			ssize_t n = ::read(polled[i].fd, buffer, sizeof(buffer));
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n > 0) {
+				outputs[i].append(buffer, n);
+				continue;
+			}
+			::close(polled[i].fd);
+			polled[i].fd = -1;
+			open--;
+		}
+	}
+
+	bool failed = false;
+	for (pid_t pid : pids) {
+		int status = 0;
+		while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+		failed = failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	}
+	if (failed)
+		throw std::runtime_error("A worker failed to train its trees");
+
+	std::vector<std::istringstream> streams;
+	std::vector<std::istream*> inputs;
+	for (auto& output : outputs)
+		streams.emplace_back(std::move(output));
+	for (auto& stream : streams)
+		inputs.push_back(&stream);
+	return merge(dr, options, inputs);
+}
+
+Bagging Distributed::merge(const DataReader& dr, const BaggingOptions& options, const std::vector<std::istream*>& slices) {
+	std::vector<Node> learners(options.ensembleSize);
+	std::vector<bool> received(options.ensembleSize, false);
+	for (std::istream* in : slices) {
+		auto [begin, trees] = Bagging::readSlice(*in);
+		if (begin + trees.size() > learners.size())
+			throw std::runtime_error("Slice beyond the size of the ensemble");
+		for (size_t i = 0; i < trees.size(); i++) {
+			if (received[begin + i])
+				throw std::runtime_error("Tree " + std::to_string(begin + i) + " is in several slices");
+			received[begin + i] = true;
+			learners[begin + i] = std::move(trees[i]);
+		}
+	}
+	for (size_t i = 0; i < received.size(); i++) {
+		if (!received[i])
+			throw std::runtime_error("Tree " + std::to_string(i) + " is in no slice");
+	}
+	return Bagging(dr, options, std::move(learners));
+}
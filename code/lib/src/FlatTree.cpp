@@ -0,0 +1,143 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <unordered_map>
+#include "FlatTree.hpp"
+
+namespace {
+	// the value of a string parsed as std::stod does in Question::isNumeric, NaN when it would throw
+	double parseNumber(const std::string& value) {
+		const char* begin = value.c_str();
+		char* end = nullptr;
+		errno = 0;
+		const double number = std::strtod(begin, &end);
+		if (end == begin || errno == ERANGE)
+			return std::numeric_limits<double>::quiet_NaN();
+		return number;
+	}
+}
+
+FlatTree::FlatTree(const Node& root, const MetaData& meta) {
+	layout(root, meta, nullptr);
+}
+
+FlatTree::FlatTree(const Node& root, const MetaData& meta, const Data& sample) {
+	// the sample rows are walked through the default layout to count the rows reaching every node
+	const std::vector<const Node*> order = layout(root, meta, nullptr);
+	std::vector<uint64_t> visits(nodes_.size(), 0);
+	for (const auto& row : sample) {
+		const FlatRow flat = encode(row, meta);
+		uint32_t i = 0;
+		visits[i]++;
+		while (nodes_[i].column >= 0) {
+			i = answer(nodes_[i], flat) ? nodes_[i].trueChild : nodes_[i].falseChild;
+			visits[i]++;
+		}
+	}
+	std::unordered_map<const Node*, uint64_t> reached;
+	for (size_t i = 0; i < order.size(); i++)
+		reached[order[i]] = visits[i];
+	layout(root, meta, &reached);
+}
+
+std::vector<const Node*> FlatTree::layout(const Node& root, const MetaData& meta, const std::unordered_map<const Node*, uint64_t>* reached) {
+	auto count = [reached](const Node* node) {
+		const auto it = reached->find(node);
+		return it == reached->end() ? uint64_t(0) : it->second;
+	};
+
+	// depth first order, the preferred child is pushed last so that it comes right after its parent
+	std::vector<const Node*> order;
+	std::vector<const Node*> cold;
+	auto place = [&](const Node* start, bool hot) {
+		std::vector<const Node*> stack{ start };
+		while (!stack.empty()) {
+			const Node* node = stack.back();
+			stack.pop_back();
+			order.push_back(node);
+			if (node->leaf() != nullptr)
+				continue;
+			const Node* first = node->trueBranch().get();
+			const Node* second = node->falseBranch().get();
+			if (hot && count(second) > count(first))
+				std::swap(first, second);
+			// a subtree the sample never reaches is laid out after all the reached nodes
+			if (hot && count(second) == 0)
+				cold.push_back(second);
+			else
+				stack.push_back(second);
+			stack.push_back(first);
+		}
+	};
+	place(&root, reached != nullptr);
+	for (size_t i = 0; i < cold.size(); i++)
+		place(cold[i], false);
+
+	std::unordered_map<const Node*, uint32_t> index;
+	for (size_t i = 0; i < order.size(); i++)
+		index[order[i]] = static_cast<uint32_t>(i);
+	nodes_.assign(order.size(), FlatNode());
+	leaves_.clear();
+	for (size_t i = 0; i < order.size(); i++) {
+		const Node* node = order[i];
+		FlatNode& flat = nodes_[i];
+		if (const Leaf* leaf = node->leaf().get(); leaf != nullptr) {
+			flat.trueChild = static_cast<uint32_t>(leaves_.size());
+			leaves_.push_back(*leaf);
+			continue;
+		}
+		const Question& question = node->question();
+		flat.column = question.column_;
+		flat.trueChild = index.at(node->trueBranch().get());
+		flat.falseChild = index.at(node->falseBranch().get());
+		// Question::solve compares numerically whenever the question value is a number
+		if (question.isNumeric()) {
+			flat.threshold = std::stod(question.value_);
+			flat.category = NumericQuestion;
+		}
+		else {
+			const auto& categories = meta.mapS2I[question.column_];
+			const auto it = categories.find(question.value_);
+			flat.category = it == categories.end() ? UnknownCategory : it->second;
+		}
+	}
+	nodes_.shrink_to_fit();
+	leaves_.shrink_to_fit();
+	return order;
+}
+
+FlatRow FlatTree::encode(const VecS& row, const MetaData& meta) {
+	FlatRow flat;
+	const size_t columns = meta.labels.size() - 1;
+	flat.numbers.resize(columns);
+	flat.categories.assign(columns, -1);
+	for (size_t col = 0; col < columns && col < row.size(); col++) {
+		flat.numbers[col] = parseNumber(row[col]);
+		if (!meta.isnumeric[col] && std::isnan(flat.numbers[col])) {
+			const auto it = meta.mapS2I[col].find(row[col]);
+			if (it != meta.mapS2I[col].end())
+				flat.categories[col] = it->second;
+		}
+	}
+	return flat;
+}
+
+const Leaf& FlatTree::classify(const FlatRow& row, uint64_t* visits) const {
+	uint32_t i = 0;
+	uint64_t depth = 1;
+	while (nodes_[i].column >= 0) {
+		i = answer(nodes_[i], row) ? nodes_[i].trueChild : nodes_[i].falseChild;
+		depth++;
+	}
+	if (visits)
+		*visits += depth;
+	return leaves_[nodes_[i].trueChild];
+}
+
+size_t FlatTree::bytes() const {
+	size_t total = nodes_.capacity() * sizeof(FlatNode) + leaves_.capacity() * sizeof(Leaf);
+	for (const auto& leaf : leaves_)
+		total += leaf.counts().capacity() * sizeof(uint32_t);
+	return total;
+}
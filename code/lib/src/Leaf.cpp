@@ -1,3 +1,25 @@
+#include <algorithm>
+#include <numeric>
 #include "Leaf.hpp"
 
-Leaf::Leaf(const ClassCounter pred) : predictions_(std::move(pred)) {}
+Leaf::Leaf(ClassCounts counts) :
+	counts_(std::move(counts)),
+	prediction_(static_cast<uint32_t>(std::distance(counts_.begin(), std::max_element(counts_.begin(), counts_.end())))),
+	value_(0) {
+	counts_.shrink_to_fit();
+}
+
+Leaf::Leaf(double value) : counts_(), prediction_(0), value_(value) {}
+
+uint32_t Leaf::total() const {
+	return std::accumulate(counts_.begin(), counts_.end(), uint32_t(0));
+}
+
+const ClassCounter Leaf::predictions(const std::vector<std::string>& classNames) const {
+	ClassCounter counter;
+	for (size_t id = 0; id < counts_.size(); id++) {
+		if (counts_[id] > 0)
+			counter[classNames.at(id)] = counts_[id];
+	}
+	return counter;
+}
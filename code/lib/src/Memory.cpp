@@ -0,0 +1,170 @@
+#include <sstream>
+#include <unordered_set>
+#include <sys/resource.h>
+#include "Memory.hpp"
+
+using std::string;
+
+namespace {
+	// make_shared places the object next to its control block: two reference counts and a vtable pointer
+	constexpr size_t SharedControlBlock = 16;
+
+	// heap bytes of a string, short strings are stored inline
+	size_t heapBytes(const string& s) {
+		return s.capacity() > string().capacity() ? s.capacity() + 1 : 0;
+	}
+
+	string jsonArray(const std::vector<size_t>& values) {
+		std::ostringstream json;
+		json << "[";
+		for (size_t i = 0; i < values.size(); i++)
+			json << (i == 0 ? "" : ", ") << values[i];
+		json << "]";
+		return json.str();
+	}
+}
+
+MemoryBudgetExceeded::MemoryBudgetExceeded(const string& what, size_t requested, size_t inUse, size_t budget) :
+	std::runtime_error("Memory budget exceeded by " + what + ": " + std::to_string(requested) + " bytes requested, "
+		+ std::to_string(inUse) + " bytes in use, budget " + std::to_string(budget) + " bytes") {}
+
+MemoryTracker::MemoryTracker(size_t budget, MemoryTracker* parent) : budget_(budget), parent_(parent), current_(0), peak_(0) {}
+
+void MemoryTracker::reserve(size_t bytes, const char* what) {
+	if (parent_)
+		parent_->reserve(bytes, what);
+	size_t now = current_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	if (budget_ > 0 && now > budget_) {
+		current_.fetch_sub(bytes, std::memory_order_relaxed);
+		if (parent_)
+			parent_->release(bytes);
+		throw MemoryBudgetExceeded(what, bytes, now - bytes, budget_);
+	}
+	size_t peak = peak_.load(std::memory_order_relaxed);
+	while (peak < now && !peak_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+}
+
+void MemoryTracker::release(size_t bytes) {
+	if (parent_)
+		parent_->release(bytes);
+	current_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::resetPeak() {
+	peak_.store(current(), std::memory_order_relaxed);
+}
+
+MemoryReservation::MemoryReservation(MemoryTracker* tracker, size_t bytes, const char* what) : tracker_(tracker), bytes_(0) {
+	if (tracker_) {
+		tracker_->reserve(bytes, what);
+		bytes_ = bytes;
+	}
+}
+
+MemoryReservation::~MemoryReservation() {
+	if (tracker_)
+		tracker_->release(bytes_);
+}
+
+void MemoryReservation::shrink(size_t bytes) {
+	if (tracker_ && bytes < bytes_) {
+		tracker_->release(bytes_ - bytes);
+		bytes_ = bytes;
+	}
+}
+
+string DataMemory::toJson() const {
+	std::ostringstream json;
+	json << "{\"train_strings\": " << trainStrings
+		<< ", \"test_strings\": " << testStrings
+		<< ", \"train_int\": " << trainInt << "}";
+	return json.str();
+}
+
+size_t MemoryReport::modelBytes() const {
+	return std::accumulate(treeBytes.begin(), treeBytes.end(), size_t(0));
+}
+
+string MemoryReport::toJson() const {
+	std::ostringstream json;
+	json << "{\"data\": " << data.toJson()
+		<< ", \"model_bytes\": " << modelBytes()
+		<< ", \"tree_bytes\": " << jsonArray(treeBytes)
+		<< ", \"bootstrap_bytes\": " << jsonArray(bootstrapBytes)
+		<< ", \"peak_transient_bytes\": " << jsonArray(peakTransientBytes)
+		<< ", \"peak_tracked_bytes\": " << peakTrackedBytes
+		<< ", \"budget\": " << budget
+		<< ", \"peak_rss_bytes\": " << Memory::peakRssBytes() << "}";
+	return json.str();
+}
+
+size_t Memory::bytes(const Data& data) {
+	size_t total = data.capacity() * sizeof(VecS);
+	for (const auto& row : data) {
+		total += row.capacity() * sizeof(string);
+		for (const auto& value : row)
+			total += heapBytes(value);
+	}
+	return total;
+}
+
+size_t Memory::bytes(const DataInt& data) {
+	size_t total = data.capacity() * sizeof(VecI);
+	for (const auto& row : data)
+		total += row.capacity() * sizeof(int);
+	return total;
+}
+
+size_t Memory::bytes(const std::vector<VecI*>& rows) {
+	return rows.capacity() * sizeof(VecI*);
+}
+
+namespace {
+	// bytes of the nodes and leaves reachable from the root which are not in the sets yet, the root excluded
+	size_t reachableBytes(const Node& root, std::unordered_set<const Node*>& nodes, std::unordered_set<const Leaf*>& leaves) {
+		std::vector<const Node*> stack{ &root };
+		size_t total = 0;
+		while (!stack.empty()) {
+			const Node* node = stack.back();
+			stack.pop_back();
+			if (const Leaf* leaf = node->leaf().get(); leaf != nullptr) {
+				if (leaves.insert(leaf).second)
+					total += SharedControlBlock + sizeof(Leaf) + leaf->counts().capacity() * sizeof(ClassCounts::value_type);
+				continue;
+			}
+			for (const Node* child : { node->trueBranch().get(), node->falseBranch().get() }) {
+				if (nodes.insert(child).second) {
+					total += SharedControlBlock + sizeof(Node) + heapBytes(child->question().value_);
+					stack.push_back(child);
+				}
+			}
+		}
+		return total;
+	}
+}
+
+size_t Memory::treeBytes(const Node& root) {
+	std::unordered_set<const Node*> nodes;
+	std::unordered_set<const Leaf*> leaves;
+	return reachableBytes(root, nodes, leaves);
+}
+
+std::vector<size_t> Memory::forestBytes(const std::vector<Node>& roots) {
+	std::unordered_set<const Node*> nodes;
+	std::unordered_set<const Leaf*> leaves;
+	std::vector<size_t> bytes;
+	for (const auto& root : roots)
+		bytes.push_back(sizeof(Node) + reachableBytes(root, nodes, leaves));
+	return bytes;
+}
+
+size_t Memory::bootstrapBytes(size_t rows, size_t columns) {
+	return rows * (sizeof(VecI) + columns * sizeof(int));
+}
+
+size_t Memory::peakRssBytes() {
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	// ru_maxrss is reported in kilobytes on Linux
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <sstream>
+#include <time.h>
+#include "Metrics.hpp"
+
+using std::string;
+
+const char* Metrics::phaseName(Phase phase) {
+	switch (phase) {
+	case Load: return "load";
+	case Encode: return "encode";
+	case Bootstrap: return "bootstrap";
+	case SplitSearch: return "split_search";
+	case Partition: return "partition";
+	case NodeConstruction: return "node_construction";
+	default: return "unknown";
+	}
+}
+
+uint64_t Metrics::threadCpuNanoseconds() {
+	timespec ts{};
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void PhaseTimes::add(const PhaseTimes& other) {
+	for (size_t phase = 0; phase < Metrics::PhaseCount; phase++) {
+		wallNs[phase].add(other.wallNs[phase].value());
+		cpuNs[phase].add(other.cpuNs[phase].value());
+	}
+}
+
+string PhaseTimes::toJson() const {
+	std::ostringstream json;
+	json << "{";
+	for (size_t phase = 0; phase < Metrics::PhaseCount; phase++) {
+		json << (phase == 0 ? "" : ", ") << "\"" << Metrics::phaseName(static_cast<Metrics::Phase>(phase)) << "\": "
+			<< "{\"wall_ns\": " << wallNs[phase].value() << ", \"cpu_ns\": " << cpuNs[phase].value() << "}";
+	}
+	json << "}";
+	return json.str();
+}
+
+#if DECISIONTREE_METRICS
+ScopedPhase::ScopedPhase(PhaseTimes* times, Metrics::Phase phase) :
+	times_(times),
+	phase_(phase),
+	wallStart_(times ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()),
+	cpuStart_(times ? Metrics::threadCpuNanoseconds() : 0) {}
+
+ScopedPhase::~ScopedPhase() {
+	if (times_ == nullptr)
+		return;
+	times_->wallNs[phase_].add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wallStart_).count());
+	times_->cpuNs[phase_].add(Metrics::threadCpuNanoseconds() - cpuStart_);
+}
+#else
+ScopedPhase::ScopedPhase(PhaseTimes*, Metrics::Phase) {}
+
+ScopedPhase::~ScopedPhase() {}
+#endif
+
+void TreeMetrics::recordLeaf(size_t depth) {
+	leaves.add(1);
+	maxDepth.max(depth);
+	depthHistogram[std::min(depth, Metrics::MaxDepthBucket - 1)].add(1);
+}
+
+string TreeMetrics::toJson() const {
+	std::ostringstream json;
+	json << "{\"wall_ns\": " << wallNs.value()
+		<< ", \"nodes\": " << nodes.value()
+		<< ", \"leaves\": " << leaves.value()
+		<< ", \"max_depth\": " << maxDepth.value()
+		<< ", \"rows_sorted\": " << rowsSorted.value()
+		<< ", \"threads_spawned\": " << threadsSpawned.value()
+		<< ", \"row_parallel_nodes\": " << rowParallelNodes.value()
+		<< ", \"depth_histogram\": [";
+	// the histogram is cut after the deepest leaf
+	size_t last = std::min<size_t>(maxDepth.value(), Metrics::MaxDepthBucket - 1);
+	for (size_t depth = 0; depth <= last; depth++)
+		json << (depth == 0 ? "" : ", ") << depthHistogram[depth].value();
+	json << "], \"phases\": " << phases.toJson() << "}";
+	return json.str();
+}
+
+string TrainingMetrics::toJson() const {
+	std::ostringstream json;
+	json << "{\"wall_ns\": " << wallNs.value()
+		<< ", \"phases\": " << phases.toJson()
+		<< ", \"trees\": [";
+	for (size_t i = 0; i < trees.size(); i++)
+		json << (i == 0 ? "" : ", ") << trees[i].toJson();
+	json << "]}";
+	return json.str();
+}
+
+string TimeBudgetReport::toJson() const {
+	std::ostringstream json;
+	json << "{\"budget_s\": " << budgetSeconds
+		<< ", \"elapsed_s\": " << elapsedSeconds
+		<< ", \"trees_planned\": " << treesPlanned
+		<< ", \"trees_built\": " << treesBuilt
+		<< ", \"stopped_by\": \"" << stoppedBy << "\""
+		<< ", \"estimate_s\": " << estimateSeconds
+		<< ", \"tree_s\": [";
+	for (size_t i = 0; i < treeSeconds.size(); i++)
+		json << (i == 0 ? "" : ", ") << treeSeconds[i];
+	json << "]}";
+	return json.str();
+}
+
+string InferenceMetrics::toJson() const {
+	std::ostringstream json;
+	const uint64_t n = predictions.value();
+	json << "{\"predictions\": " << n
+		<< ", \"node_visits\": " << nodeVisits.value()
+		<< ", \"node_visits_per_prediction\": " << (n > 0 ? static_cast<double>(nodeVisits.value()) / n : 0.0) << "}";
+	return json.str();
+}
@@ -11,3 +11,10 @@ Node::Node(const Node &trueBranch, const Node &falseBranch, const Question &ques
     falseBranch_(make_shared<Node>(falseBranch)),
     question_(question),
     leaf_(nullptr) {}
+
+// a Node is never modified once built, the branches are only const for the callers sharing them
+Node::Node(std::shared_ptr<const Node> trueBranch, std::shared_ptr<const Node> falseBranch, const Question &question) :
+    trueBranch_(std::const_pointer_cast<Node>(std::move(trueBranch))),
+    falseBranch_(std::const_pointer_cast<Node>(std::move(falseBranch))),
+    question_(question),
+    leaf_(nullptr) {}
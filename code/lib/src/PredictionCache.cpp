@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include "PredictionCache.hpp"
+
+PredictionCache::PredictionCache(size_t capacity, size_t shards) :
+	capacity_(std::max<size_t>(1, capacity)),
+	shardCapacity_(0),
+	shards_(),
+	hits_(),
+	misses_(),
+	evictions_() {
+	// small caches keep a single shard so that their capacity is not spread too thin
+	shards = std::max<size_t>(1, std::min(shards, capacity_ / 64));
+	shardCapacity_ = (capacity_ + shards - 1) / shards;
+	for (size_t i = 0; i < shards; i++)
+		shards_.push_back(std::make_unique<Shard>());
+}
+
+PredictionCache::Key PredictionCache::key(const FlatRow& row, const std::vector<int>& columns) {
+	// NaN bit patterns are never produced by a number, they hold the category ids
+	constexpr uint64_t CategoryTag = 0x7ff8000000000000ULL;
+	Key key(columns.size());
+	for (size_t i = 0; i < columns.size(); i++) {
+		const double number = row.numbers[columns[i]];
+		if (std::isnan(number)) {
+			key[i] = CategoryTag | static_cast<uint32_t>(row.categories[columns[i]]);
+		}
+		else {
+			// -0 and 0 answer every question alike
+			const double value = number == 0 ? 0.0 : number;
+			std::memcpy(&key[i], &value, sizeof(value));
+		}
+	}
+	return key;
+}
+
+size_t PredictionCache::KeyHash::operator()(const Key& key) const {
+	// 64 bit FNV-1a over the values, followed by a final mix of the bits
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint64_t value : key) {
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return static_cast<size_t>(hash);
+}
+
+PredictionCache::Shard& PredictionCache::shard(const Key& key) {
+	// the high bits select the shard, the map of the shard buckets on the low bits
+	return *shards_[(KeyHash()(key) >> 48) % shards_.size()];
+}
+
+bool PredictionCache::find(const Key& key, uint64_t version, uint32_t& prediction) {
+	Shard& s = shard(key);
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+		const auto it = s.index.find(key);
+		if (it != s.index.end()) {
+			Entry& entry = s.entries[it->second];
+			// an entry of another version of the model is replaced by the next insert
+			if (entry.version == version) {
+				entry.referenced = true;
+				prediction = entry.prediction;
+				hits_.add(1);
+				return true;
+			}
+		}
+	}
+	misses_.add(1);
+	return false;
+}
+
+void PredictionCache::insert(const Key& key, uint64_t version, uint32_t prediction) {
+	Shard& s = shard(key);
+	std::lock_guard<std::mutex> lock(s.mutex);
+	if (const auto it = s.index.find(key); it != s.index.end()) {
+		Entry& entry = s.entries[it->second];
+		entry.version = version;
+		entry.prediction = prediction;
+		entry.referenced = true;
+		return;
+	}
+	if (s.entries.size() < shardCapacity_) {
+		s.index.emplace(key, s.entries.size());
+		s.entries.push_back(Entry{ key, version, prediction, false });
+		return;
+	}
+	// CLOCK: give the entries hit since the last pass a second chance
+	while (s.entries[s.hand].referenced) {
+		s.entries[s.hand].referenced = false;
+		s.hand = (s.hand + 1) % s.entries.size();
+	}
+	Entry& victim = s.entries[s.hand];
+	s.index.erase(victim.key);
+	victim = Entry{ key, version, prediction, false };
+	s.index.emplace(key, s.hand);
+	s.hand = (s.hand + 1) % s.entries.size();
+	evictions_.add(1);
+}
+
+void PredictionCache::clear() {
+	for (auto& s : shards_) {
+		std::lock_guard<std::mutex> lock(s->mutex);
+		s->entries.clear();
+		s->index.clear();
+		s->hand = 0;
+	}
+}
+
+size_t PredictionCache::size() const {
+	size_t total = 0;
+	for (const auto& s : shards_) {
+		std::lock_guard<std::mutex> lock(s->mutex);
+		total += s->entries.size();
+	}
+	return total;
+}
+
+std::string PredictionCache::toJson() const {
+	std::ostringstream json;
+	const uint64_t lookups = hits() + misses();
+	json << "{\"capacity\": " << capacity_
+		<< ", \"size\": " << size()
+		<< ", \"hits\": " << hits()
+		<< ", \"misses\": " << misses()
+		<< ", \"evictions\": " << evictions()
+		<< ", \"hit_rate\": " << (lookups > 0 ? static_cast<double>(hits()) / lookups : 0.0) << "}";
+	return json.str();
+}
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/algorithm/string.hpp>
+#include "PredictionServer.hpp"
+
+using std::string;
+using std::vector;
+using Clock = std::chrono::steady_clock;
+
+std::string LatencyReport::toJson() const {
+	std::ostringstream json;
+	json << "{\"count\": " << count
+		<< ", \"p50_us\": " << p50
+		<< ", \"p90_us\": " << p90
+		<< ", \"p99_us\": " << p99
+		<< ", \"p999_us\": " << p999
+		<< ", \"max_us\": " << max << "}";
+	return json.str();
+}
+
+PredictionServer::PredictionServer(const Bagging& model, ServerOptions options) :
+	model_(model),
+	options_(options),
+	pool_(options.threads),
+	queue_(),
+	queueMutex_(),
+	queueCondition_(),
+	stopping_(false),
+	latencies_({}),
+	latencyCount_(0),
+	latencyMutex_(),
+	batcher_() {
+	if (options_.maxBatchSize == 0)
+		throw std::invalid_argument("The maximum batch size must be at least 1");
+	batcher_ = std::thread([this]() { batchLoop(); });
+}
+
+PredictionServer::~PredictionServer() {
+	stop();
+	if (batcher_.joinable())
+		batcher_.join();
+}
+
+void PredictionServer::stop() {
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		stopping_ = true;
+	}
+	queueCondition_.notify_all();
+}
+
+std::future<string> PredictionServer::submit(VecS row) {
+	Request request{ std::move(row), std::promise<string>(), Clock::now() };
+	std::future<string> result = request.result.get_future();
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		if (stopping_) {
+			request.result.set_value("ERROR server is stopping");
+			return result;
+		}
+		queue_.push_back(std::move(request));
+	}
+	queueCondition_.notify_one();
+	return result;
+}
+
+void PredictionServer::batchLoop() {
+	while (true) {
+		vector<Request> batch;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex_);
+			queueCondition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+			// pending requests are still answered when stopping, the loop only ends on an empty queue
+			if (queue_.empty())
+				return;
+			// give concurrent clients the chance to fill the batch until the oldest request expires
+			const auto deadline = queue_.front().arrival + options_.maxWait;
+			queueCondition_.wait_until(lock, deadline, [this]() { return stopping_ || queue_.size() >= options_.maxBatchSize; });
+			size_t n = std::min(queue_.size(), options_.maxBatchSize);
+			batch.reserve(n);
+			for (size_t i = 0; i < n; i++) {
+				batch.push_back(std::move(queue_.front()));
+				queue_.pop_front();
+			}
+		}
+		runBatch(batch);
+	}
+}
+
+void PredictionServer::runBatch(vector<Request>& batch) {
+	const size_t columns = model_.metaData().labels.size() - 1; // number of attributes without the class column
+	Data rows; // the valid rows of the batch
+	vector<size_t> index; // position in the batch of every valid row
+	VecS predictions;
+	rows.reserve(batch.size());
+	index.reserve(batch.size());
+
+	for (size_t i = 0; i < batch.size(); i++) {
+		if (batch[i].row.size() < columns) {
+			batch[i].result.set_value("ERROR expected " + std::to_string(columns) + " attribute values");
+		}
+		else {
+			rows.push_back(std::move(batch[i].row));
+			index.push_back(i);
+		}
+	}
+
+	try {
+		predictions = model_.predict(rows, pool_);
+	}
+	catch (const std::exception&) {
+		// one of the rows is malformed, score them one by one to isolate it
+		predictions.assign(rows.size(), string());
+		for (size_t i = 0; i < rows.size(); i++) {
+			try {
+				predictions[i] = model_.predict(rows[i]);
+			}
+			catch (const std::exception& e) {
+				predictions[i] = string("ERROR ") + e.what();
+			}
+		}
+	}
+
+	const auto now = Clock::now();
+	vector<double> latencies;
+	latencies.reserve(batch.size());
+	for (const auto& request : batch) {
+		latencies.push_back(std::chrono::duration<double, std::micro>(now - request.arrival).count());
+	}
+	// recorded before answering, so that a client reading the statistics after its responses sees them
+	recordLatencies(latencies);
+	for (size_t i = 0; i < rows.size(); i++) {
+		batch[index[i]].result.set_value(std::move(predictions[i]));
+	}
+}
+
+void PredictionServer::recordLatencies(const vector<double>& latencies) {
+	std::lock_guard<std::mutex> lock(latencyMutex_);
+	for (double latency : latencies) {
+		if (latencies_.size() < options_.latencyWindow)
+			latencies_.push_back(latency);
+		else
+			latencies_[latencyCount_ % options_.latencyWindow] = latency;
+		latencyCount_++;
+	}
+}
+
+LatencyReport PredictionServer::latency() const {
+	vector<double> sorted;
+	LatencyReport report;
+	{
+		std::lock_guard<std::mutex> lock(latencyMutex_);
+		sorted = latencies_;
+		report.count = latencyCount_;
+	}
+	if (sorted.empty())
+		return report;
+	std::sort(sorted.begin(), sorted.end());
+	// nearest rank percentile over the latency window
+	auto percentile = [&sorted](double p) {
+		size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+	};
+	report.p50 = percentile(0.50);
+	report.p90 = percentile(0.90);
+	report.p99 = percentile(0.99);
+	report.p999 = percentile(0.999);
+	report.max = sorted.back();
+	return report;
+}
+
+void PredictionServer::serveLines(const std::function<bool(string&)>& readLine, const std::function<void(const string&)>& writeLine) {
+	std::deque<std::future<string>> pending; // responses in the order of the requests
+	std::mutex pendingMutex;
+	std::condition_variable pendingCondition;
+	bool done = false;
+
+	// the responses are written by a separate thread so that the reader keeps feeding the batches
+	std::thread writer([&]() {
+		while (true) {
+			std::future<string> response;
+			{
+				std::unique_lock<std::mutex> lock(pendingMutex);
+				pendingCondition.wait(lock, [&]() { return done || !pending.empty(); });
+				if (pending.empty())
+					return;
+				response = std::move(pending.front());
+				pending.pop_front();
+			}
+			writeLine(response.get());
+		}
+		});
+
+	string line;
+	while (readLine(line)) {
+		boost::trim(line);
+		if (line.empty())
+			continue;
+		std::future<string> response;
+		if (line == "STATS") {
+			std::promise<string> stats;
+			stats.set_value(latency().toJson());
+			response = stats.get_future();
+		}
+		else {
+			VecS row;
+			boost::algorithm::split(row, line, boost::is_any_of(","));
+			for (auto& value : row)
+				boost::trim(value);
+			response = submit(std::move(row));
+		}
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			pending.push_back(std::move(response));
+		}
+		pendingCondition.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		done = true;
+	}
+	pendingCondition.notify_one();
+	writer.join();
+}
+
+void PredictionServer::serveStream(std::istream& in, std::ostream& out) {
+	std::mutex outMutex;
+	serveLines(
+		[&in](string& line) { return static_cast<bool>(std::getline(in, line)); },
+		[&out, &outMutex](const string& response) {
+			std::lock_guard<std::mutex> lock(outMutex);
+			out << response << "\n" << std::flush;
+		});
+}
+
+void PredictionServer::serveUnixSocket(const string& path) {
+	sockaddr_un address{};
+	if (path.size() >= sizeof(address.sun_path))
+		throw std::invalid_argument("Socket path is too long: " + path);
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+		throw std::runtime_error("Can't create socket: " + string(std::strerror(errno)));
+	// remove a stale socket left behind by a previous run
+	::unlink(path.c_str());
+	if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 128) < 0) {
+		string error = std::strerror(errno);
+		::close(listener);
+		throw std::runtime_error("Can't listen on socket " + path + ": " + error);
+	}
+
+	vector<std::thread> connections;
+	vector<int> clients;
+	// handlers which have closed their client, joined by the accept loop
+	vector<std::thread::id> finished;
+	std::mutex clientsMutex;
+
+	while (!stopping_) {
+		{
+			std::lock_guard<std::mutex> lock(clientsMutex);
+			for (const auto& id : finished) {
+				auto done = std::find_if(connections.begin(), connections.end(),
+					[&id](const std::thread& connection) { return connection.get_id() == id; });
+				done->join();
+				connections.erase(done);
+			}
+			finished.clear();
+		}
+		// poll with a timeout so that stop() is noticed without a pending connection
+		pollfd poller{ listener, POLLIN, 0 };
+		if (poll(&poller, 1, 100) <= 0)
+			continue;
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0)
+			continue;
+		{
+			std::lock_guard<std::mutex> lock(clientsMutex);
+			clients.push_back(client);
+		}
+		connections.emplace_back([this, client, &clients, &finished, &clientsMutex]() {
+			string buffer;
+			char chunk[4096];
+			serveLines(
+				[client, &buffer, &chunk](string& line) {
+					size_t newline;
+					while ((newline = buffer.find('\n')) == string::npos) {
+						ssize_t received = ::recv(client, chunk, sizeof(chunk), 0);
+						if (received <= 0) {
+							// a last request without trailing newline is still served
+							if (buffer.empty())
+								return false;
+							line.swap(buffer);
+							buffer.clear();
+							return true;
+						}
+						buffer.append(chunk, received);
+					}
+					line = buffer.substr(0, newline);
+					buffer.erase(0, newline + 1);
+					return true;
+				},
+				[client](const string& response) {
+					string message = response + "\n";
+					size_t sent = 0;
+					while (sent < message.size()) {
+						ssize_t n = ::send(client, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+						if (n <= 0)
+							return;
+						sent += n;
+					}
+				});
+			std::lock_guard<std::mutex> lock(clientsMutex);
+			clients.erase(std::find(clients.begin(), clients.end(), client));
+			::close(client);
+			finished.push_back(std::this_thread::get_id());
+			});
+	}
+
+	::close(listener);
+	::unlink(path.c_str());
+	{
+		// unblock the connections still waiting for requests, they can still send the responses in flight
+		std::lock_guard<std::mutex> lock(clientsMutex);
+		for (int client : clients)
+			::shutdown(client, SHUT_RD);
+	}
+	for (auto& connection : connections)
+		connection.join();
+}
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include "Pruning.hpp"
+
+using std::string;
+
+namespace {
+	// a node of the tree with the statistics of its subtree, the nodes are indexed in preorder
+	struct Entry {
+		const Node* node = nullptr;
+		int parent = -1;
+		int trueChild = -1;
+		int falseChild = -1;
+		// nodes of the unpruned subtree, which spans the indices [i, i + span)
+		size_t span = 1;
+		// summed class counts of the leaves and the majority class, the lowest id wins ties as in Leaf
+		ClassCounts counts{};
+		uint32_t prediction = 0;
+		// training errors of the node as a leaf and of the leaves of its current subtree
+		uint64_t leafErrors = 0;
+		uint64_t subtreeErrors = 0;
+		size_t leaves = 1;
+		size_t nodes = 1;
+		// validation rows classified correctly by the node as a leaf and by its current subtree
+		uint64_t leafCorrect = 0;
+		uint64_t subtreeCorrect = 0;
+		bool collapsed = false;
+
+		inline bool inner() const { return trueChild >= 0 && !collapsed; }
+	};
+
+	class Pruner {
+	public:
+		Pruner(const Node& root, const MetaData* meta, const Data& validation) : entries_(), rows_(0), scored_(0) {
+			index(root);
+			if (meta != nullptr)
+				score(*meta, validation);
+		}
+
+		// the smallest g(t) of the inner nodes of the current tree, infinity when the root is a leaf
+		double weakestLink() const {
+			double weakest = std::numeric_limits<double>::infinity();
+			for (size_t i = 0; i < entries_.size();) {
+				const Entry& e = entries_[i];
+				if (!e.inner()) {
+					i += e.span;
+					continue;
+				}
+				weakest = std::min(weakest, g(e));
+				i++;
+			}
+			return weakest;
+		}
+
+		// collapses every node of the current tree with g(t) <= alpha, the parents first
+		void collapse(double alpha) {
+			// g of a parent is never below that of its weakest descendant, within rounding
+			const double limit = alpha + 1e-12;
+			for (size_t i = 0; i < entries_.size();) {
+				const Entry& e = entries_[i];
+				if (!e.inner()) {
+					i += e.span;
+					continue;
+				}
+				if (g(e) <= limit) {
+					collapse(i);
+					i += e.span;
+				}
+				else {
+					i++;
+				}
+			}
+		}
+
+		// bottom up, so that every subtree is compared with its own pruned subtrees
+		void reduceErrors() {
+			for (size_t i = entries_.size(); i-- > 0;) {
+				Entry& e = entries_[i];
+				if (e.trueChild < 0)
+					continue;
+				if (e.leafCorrect >= e.subtreeCorrect)
+					collapse(i);
+			}
+		}
+
+		PruningStep step(double alpha) const {
+			const Entry& root = entries_.front();
+			PruningStep s;
+			s.alpha = alpha;
+			s.nodes = root.nodes;
+			s.leaves = root.leaves;
+			s.trainingError = rows_ > 0 ? static_cast<double>(root.subtreeErrors) / rows_ : 0;
+			s.validationAccuracy = scored_ > 0 ? static_cast<double>(root.subtreeCorrect) / scored_ : 0;
+			return s;
+		}
+
+		Node build() const {
+			return build(0);
+		}
+
+	private:
+		std::vector<Entry> entries_;
+		// training rows of the tree and scored validation rows
+		uint64_t rows_;
+		uint64_t scored_;
+
+		// increase of the training error rate per leaf removed by collapsing the node
+		inline double g(const Entry& e) const {
+			return static_cast<double>(e.leafErrors - e.subtreeErrors) / rows_ / (e.leaves - 1);
+		}
+
+		void index(const Node& root) {
+			// (node, parent, true branch)
+			std::vector<std::tuple<const Node*, int, bool>> stack{ { &root, -1, true } };
+			while (!stack.empty()) {
+				const auto [node, parent, isTrue] = stack.back();
+				stack.pop_back();
+				const int i = static_cast<int>(entries_.size());
+				entries_.push_back(Entry());
+				entries_.back().node = node;
+				entries_.back().parent = parent;
+				if (parent >= 0)
+					(isTrue ? entries_[parent].trueChild : entries_[parent].falseChild) = i;
+				if (node->leaf() == nullptr) {
+					stack.emplace_back(node->falseBranch().get(), i, false);
+					stack.emplace_back(node->trueBranch().get(), i, true);
+				}
+			}
+			// the children come after their parent
+			for (size_t i = entries_.size(); i-- > 0;) {
+				Entry& e = entries_[i];
+				if (e.trueChild < 0) {
+					e.counts = e.node->leaf()->counts();
+					if (e.counts.empty())
+						throw std::runtime_error("Only classification trees can be pruned");
+				}
+				else {
+					const Entry& t = entries_[e.trueChild];
+					const Entry& f = entries_[e.falseChild];
+					// leaves of trees trained before new classes were merged hold fewer counts
+					e.counts.assign(std::max(t.counts.size(), f.counts.size()), 0);
+					for (size_t id = 0; id < t.counts.size(); id++)
+						e.counts[id] += t.counts[id];
+					for (size_t id = 0; id < f.counts.size(); id++)
+						e.counts[id] += f.counts[id];
+					e.span = 1 + t.span + f.span;
+					e.nodes = e.span;
+					e.leaves = t.leaves + f.leaves;
+				}
+				const auto majority = std::max_element(e.counts.begin(), e.counts.end());
+				e.prediction = static_cast<uint32_t>(std::distance(e.counts.begin(), majority));
+				e.leafErrors = std::accumulate(e.counts.begin(), e.counts.end(), uint64_t(0)) - *majority;
+				e.subtreeErrors = e.trueChild < 0 ? e.leafErrors
+					: entries_[e.trueChild].subtreeErrors + entries_[e.falseChild].subtreeErrors;
+			}
+			rows_ = std::accumulate(entries_.front().counts.begin(), entries_.front().counts.end(), uint64_t(0));
+		}
+
+		// every validation row walks the tree once, counting at every node it reaches whether the node predicts it
+		void score(const MetaData& meta, const Data& validation) {
+			const auto& classIds = meta.mapS2I.back();
+			for (const auto& row : validation) {
+				const auto label = classIds.find(row.back());
+				if (label == classIds.end())
+					continue;
+				scored_++;
+				int i = 0;
+				while (true) {
+					Entry& e = entries_[i];
+					e.leafCorrect += e.prediction == static_cast<uint32_t>(label->second);
+					if (e.trueChild < 0)
+						break;
+					i = e.node->question().solve(row) ? e.trueChild : e.falseChild;
+				}
+			}
+			for (size_t i = entries_.size(); i-- > 0;) {
+				Entry& e = entries_[i];
+				e.subtreeCorrect = e.trueChild < 0 ? e.leafCorrect
+					: entries_[e.trueChild].subtreeCorrect + entries_[e.falseChild].subtreeCorrect;
+			}
+		}
+
+		// the node becomes a leaf, its ancestors lose the nodes, leaves and errors of its subtree
+		void collapse(size_t i) {
+			Entry& e = entries_[i];
+			const size_t nodes = e.nodes - 1, leaves = e.leaves - 1;
+			const uint64_t errors = e.leafErrors - e.subtreeErrors;
+			const int64_t correct = static_cast<int64_t>(e.leafCorrect) - static_cast<int64_t>(e.subtreeCorrect);
+			e.collapsed = true;
+			for (int a = static_cast<int>(i); a >= 0; a = entries_[a].parent) {
+				Entry& ancestor = entries_[a];
+				ancestor.nodes -= nodes;
+				ancestor.leaves -= leaves;
+				ancestor.subtreeErrors += errors;
+				ancestor.subtreeCorrect = static_cast<uint64_t>(static_cast<int64_t>(ancestor.subtreeCorrect) + correct);
+			}
+		}
+
+		Node build(int i) const {
+			const Entry& e = entries_[i];
+			if (e.trueChild < 0)
+				return *e.node;
+			if (e.collapsed)
+				return Node(Leaf(e.counts));
+			return Node(build(e.trueChild), build(e.falseChild), e.node->question());
+		}
+	};
+}
+
+std::vector<PruningStep> Pruning::costComplexityPath(const Node& root, const MetaData& meta, const Data& validation) {
+	Pruner pruner(root, &meta, validation);
+	std::vector<PruningStep> path{ pruner.step(0) };
+	for (double alpha = pruner.weakestLink(); alpha < std::numeric_limits<double>::infinity(); alpha = pruner.weakestLink()) {
+		pruner.collapse(alpha);
+		path.push_back(pruner.step(alpha));
+	}
+	return path;
+}
+
+Node Pruning::costComplexity(const Node& root, double alpha) {
+	Pruner pruner(root, nullptr, {});
+	// collapsing the weakest links raises g of their ancestors, until none is below alpha
+	for (double weakest = pruner.weakestLink(); weakest <= alpha; weakest = pruner.weakestLink())
+		pruner.collapse(weakest);
+	return pruner.build();
+}
+
+Node Pruning::reducedError(const Node& root, const MetaData& meta, const Data& validation) {
+	Pruner pruner(root, &meta, validation);
+	pruner.reduceErrors();
+	return pruner.build();
+}
+
+PruningStep Pruning::evaluate(const Node& root, const MetaData& meta, const Data& validation) {
+	return Pruner(root, &meta, validation).step(0);
+}
+
+size_t Pruning::countNodes(const Node& root) {
+	size_t nodes = 0;
+	std::vector<const Node*> stack{ &root };
+	while (!stack.empty()) {
+		const Node* node = stack.back();
+		stack.pop_back();
+		nodes++;
+		if (node->leaf() == nullptr) {
+			stack.push_back(node->trueBranch().get());
+			stack.push_back(node->falseBranch().get());
+		}
+	}
+	return nodes;
+}
+
+string Pruning::toJson(const std::vector<PruningStep>& path) {
+	std::ostringstream json;
+	json << "[";
+	for (size_t i = 0; i < path.size(); i++) {
+		json << (i == 0 ? "" : ", ")
+			<< "{\"alpha\": " << path[i].alpha
+			<< ", \"nodes\": " << path[i].nodes
+			<< ", \"leaves\": " << path[i].leaves
+			<< ", \"training_error\": " << path[i].trainingError
+			<< ", \"validation_accuracy\": " << path[i].validationAccuracy << "}";
+	}
+	json << "]";
+	return json.str();
+}
@@ -8,7 +8,7 @@ Question::Question() : column_(0), value_("") {}
 
 Question::Question(const int column, const string value) : column_(column), value_(value) {}
 
-const bool Question::solve(VecS example) const {
+const bool Question::solve(const VecS& example) const {
   const string& val = example[column_];
   if (isNumeric(val)) {
     return std::stod(val) >= std::stod(value_);
@@ -0,0 +1,116 @@
+#include <stdexcept>
+#include "Serialization.hpp"
+
+using std::string;
+
+namespace {
+	void expect(std::istream& in, const string& keyword) {
+		string word;
+		if (!(in >> word) || word != keyword)
+			throw std::runtime_error("Malformed model: expected '" + keyword + "' but read '" + word + "'");
+	}
+
+	template<typename T>
+	T readValue(std::istream& in) {
+		T value;
+		if (!(in >> value))
+			throw std::runtime_error("Malformed model: expected a number");
+		return value;
+	}
+}
+
+void Serialization::writeString(std::ostream& out, const string& value) {
+	out << value.size() << ":" << value;
+}
+
+string Serialization::readString(std::istream& in) {
+	size_t length = readValue<size_t>(in);
+	if (in.get() != ':')
+		throw std::runtime_error("Malformed model: expected a string");
+	string value(length, '\0');
+	if (!in.read(&value[0], length))
+		throw std::runtime_error("Malformed model: truncated string");
+	return value;
+}
+
+void Serialization::writeMetaData(std::ostream& out, const MetaData& meta) {
+	out << "columns " << meta.labels.size() << "\n";
+	for (size_t col = 0; col < meta.labels.size(); col++) {
+		writeString(out, meta.labels[col]);
+		out << " " << (meta.isnumeric[col] ? 1 : 0) << " " << meta.mapI2S[col].size();
+		for (const auto& [id, value] : meta.mapI2S[col]) {
+			out << " " << id << " ";
+			writeString(out, value);
+		}
+		out << "\n";
+	}
+	out << "classes " << meta.classNames.size();
+	for (const auto& name : meta.classNames) {
+		out << " ";
+		writeString(out, name);
+	}
+	out << "\n";
+}
+
+MetaData Serialization::readMetaData(std::istream& in) {
+	MetaData meta{};
+	expect(in, "columns");
+	size_t columns = readValue<size_t>(in);
+	for (size_t col = 0; col < columns; col++) {
+		in >> std::ws;
+		meta.labels.push_back(readString(in));
+		meta.isnumeric.push_back(readValue<int>(in) != 0);
+		meta.mapS2I.push_back({});
+		meta.mapI2S.push_back({});
+		size_t categories = readValue<size_t>(in);
+		for (size_t i = 0; i < categories; i++) {
+			int id = readValue<int>(in);
+			in >> std::ws;
+			string value = readString(in);
+			meta.mapS2I.back()[value] = id;
+			meta.mapI2S.back()[id] = value;
+		}
+	}
+	expect(in, "classes");
+	size_t classes = readValue<size_t>(in);
+	for (size_t i = 0; i < classes; i++) {
+		in >> std::ws;
+		meta.classNames.push_back(readString(in));
+	}
+	return meta;
+}
+
+void Serialization::writeTree(std::ostream& out, const Node& root) {
+	if (const auto& leaf = root.leaf(); leaf != nullptr) {
+		out << "L " << leaf->counts().size();
+		for (auto count : leaf->counts())
+			out << " " << count;
+		out << "\n";
+		return;
+	}
+	out << "N " << root.question().column_ << " ";
+	writeString(out, root.question().value_);
+	out << "\n";
+	writeTree(out, *root.trueBranch());
+	writeTree(out, *root.falseBranch());
+}
+
+Node Serialization::readTree(std::istream& in) {
+	string kind;
+	in >> kind;
+	if (kind == "L") {
+		ClassCounts counts(readValue<size_t>(in));
+		for (auto& count : counts)
+			count = readValue<uint32_t>(in);
+		return Node(Leaf(std::move(counts)));
+	}
+	if (kind == "N") {
+		int column = readValue<int>(in);
+		in >> std::ws;
+		Question question(column, readString(in));
+		Node trueBranch = readTree(in);
+		Node falseBranch = readTree(in);
+		return Node(trueBranch, falseBranch, question);
+	}
+	throw std::runtime_error("Malformed model: unknown node kind '" + kind + "'");
+}
@@ -0,0 +1,46 @@
+#include <algorithm>
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t threads) :
+	workers_(),
+	tasks_(),
+	mutex_(),
+	condition_(),
+	stopping_(false) {
+	threads = std::max<size_t>(1, threads);
+	workers_.reserve(threads);
+	for (size_t i = 0; i < threads; i++) {
+		workers_.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	condition_.notify_all();
+	for (auto& worker : workers_)
+		worker.join();
+}
+
+size_t ThreadPool::defaultThreads() {
+	// hardware_concurrency is allowed to return 0 when the value is not computable
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+			// remaining tasks are still executed when the pool is being destroyed
+			if (tasks_.empty())
+				return;
+			task = std::move(tasks_.front());
+			tasks_.pop();
+		}
+		task();
+	}
+}
@@ -4,13 +4,12 @@ using std::make_shared;
 using std::shared_ptr;
 
 TreeTest::TreeTest(const Data& testData, const MetaData& meta, const Node& root) {
-	test(testData, meta.labels, make_shared<Node>(root));
+	test(testData, meta, make_shared<Node>(root));
 }
 
-const ClassCounter TreeTest::classify(const VecS& row, shared_ptr<Node> node) const {
+const Leaf& TreeTest::classify(const VecS& row, shared_ptr<Node> node) const {
 	if (bool is_leaf = node->leaf() != nullptr; is_leaf) {
-		const auto& leaf = node->leaf();
-		return leaf->predictions();
+		return *node->leaf();
 	}
 
 	if (node->question().solve(row))
@@ -19,24 +18,36 @@ const ClassCounter TreeTest::classify(const VecS& row, shared_ptr<Node> node) co
 		return classify(row, node->falseBranch());
 }
 
-void TreeTest::printLeaf(ClassCounter counts) const {
-	const float total = static_cast<float>(Utils::tree::mapValueSum(counts));
+const Leaf& TreeTest::classify(const VecS& row, const Node& root, uint64_t* visits) const {
+	const Node* node = &root;
+	uint64_t depth = 1;
+	while (node->leaf() == nullptr) {
+		node = node->question().solve(row) ? node->trueBranch().get() : node->falseBranch().get();
+		depth++;
+	}
+	if (visits)
+		*visits += depth;
+	return *node->leaf();
+}
+
+void TreeTest::printLeaf(const Leaf& leaf, const VecS& classNames) const {
+	const float total = static_cast<float>(leaf.total());
 	ClassCounterScaled scale;
 
-	for (const auto& [key, val] : counts)
+	for (const auto& [key, val] : leaf.predictions(classNames))
 		scale[key] = std::to_string(val / total * 100) + "%";
 
 	Utils::print::print_map(scale);
 }
 
-void TreeTest::test(const Data& testData, const VecS& labels, shared_ptr<Node> tree) const {
+void TreeTest::test(const Data& testData, const MetaData& meta, shared_ptr<Node> tree) const {
 	float accuracy = 0;
 	for (const auto& row : testData) {
 		const auto& classification = classify(row, tree);
 		static size_t last = row.size() - 1;
 		// Comment out this line to print the predicion of each example
-		// std::cout << "Actual: " << row[last] << "\tPrediction: "; printLeaf(classification);
-		if (Utils::tree::getMax(classification) == row[last])
+		// std::cout << "Actual: " << row[last] << "\tPrediction: "; printLeaf(classification, meta.classNames);
+		if (meta.classNames[classification.prediction()] == row[last])
 			accuracy += 1;
 	}
 	std::cout << "Total accuracy: " << (accuracy / testData.size()) << std::endl;
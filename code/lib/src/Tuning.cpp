@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include "DecisionTree.hpp"
+#include "Metrics.hpp"
+#include "Tuning.hpp"
+#include "Validation.hpp"
+
+using std::string;
+
+namespace {
+	// a fold of the training data, as a view over the rows of the DataReader
+	struct Fold {
+		std::vector<VecI*> train{};
+		Data validation{};
+	};
+
+	// the trees of a (configuration, fold) pair under construction
+	struct Pair {
+		std::vector<Node> trees{};
+		std::atomic<size_t> remaining{ 0 };
+		double accuracy = 0;
+		double logLoss = 0;
+	};
+
+	// timings of a configuration, updated by the jobs of all its pairs
+	struct Timing {
+		Counter cpuNs{};
+		std::atomic<uint64_t> firstStart{ UINT64_MAX };
+		std::atomic<uint64_t> lastEnd{ 0 };
+	};
+
+	uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void atomicMin(std::atomic<uint64_t>& value, uint64_t n) {
+		uint64_t current = value.load(std::memory_order_relaxed);
+		while (n < current && !value.compare_exchange_weak(current, n, std::memory_order_relaxed)) {}
+	}
+
+	void atomicMax(std::atomic<uint64_t>& value, uint64_t n) {
+		uint64_t current = value.load(std::memory_order_relaxed);
+		while (n > current && !value.compare_exchange_weak(current, n, std::memory_order_relaxed)) {}
+	}
+
+	string describe(const BaggingOptions& options) {
+		std::ostringstream out;
+		out << "trees=" << options.ensembleSize << " max_depth=" << options.tree.maxDepth << " min_rows_split=" << options.tree.minRowsSplit
+			<< (options.tree.extraTrees ? " splits=random" : "");
+		return out.str();
+	}
+}
+
+std::vector<BaggingOptions> Tuning::grid(const ParameterGrid& grid, const BaggingOptions& base) {
+	std::vector<BaggingOptions> configurations;
+	for (int ensembleSize : grid.ensembleSize) {
+		for (size_t maxDepth : grid.maxDepth) {
+			for (size_t minRowsSplit : grid.minRowsSplit) {
+				BaggingOptions options = base;
+				options.ensembleSize = ensembleSize;
+				options.tree.maxDepth = maxDepth;
+				options.tree.minRowsSplit = minRowsSplit;
+				configurations.push_back(options);
+			}
+		}
+	}
+	return configurations;
+}
+
+std::vector<BaggingOptions> Tuning::sample(const std::vector<BaggingOptions>& configurations, size_t count, uint seed) {
+	std::vector<BaggingOptions> sampled(configurations);
+	std::mt19937_64 generator(seed);
+	std::shuffle(sampled.begin(), sampled.end(), generator);
+	sampled.resize(std::min(count, sampled.size()));
+	return sampled;
+}
+
+std::vector<SearchResult> Tuning::crossValidate(const DataReader& dr, const std::vector<BaggingOptions>& configurations, const SearchOptions& options) {
+	const DataInt& data = dr.trainDataInt();
+	const Data& strings = dr.trainData();
+	if (!dr.hasTrainStrings())
+		throw std::runtime_error("Cross-validation scores the training strings, the reader dropped them");
+	const size_t rows = data.size();
+	const size_t k = std::min(options.folds, rows);
+	if (k < 2)
+		throw std::runtime_error("Cross-validation needs at least two folds");
+
+	// assign the rows to the folds once, every configuration is evaluated on the same folds
+	std::vector<size_t> order(rows);
+	std::iota(order.begin(), order.end(), 0);
+	std::mt19937_64 shuffler(options.seed);
+	std::shuffle(order.begin(), order.end(), shuffler);
+	std::vector<size_t> fold_of(rows);
+	for (size_t i = 0; i < rows; i++)
+		fold_of[order[i]] = i % k;
+	std::vector<Fold> folds(k);
+	for (size_t row = 0; row < rows; row++) {
+		for (size_t f = 0; f < k; f++) {
+			if (fold_of[row] == f)
+				folds[f].validation.push_back(strings[row]);
+			else
+				folds[f].train.push_back(const_cast<VecI*>(&data[row]));
+		}
+	}
+
+	// one job per tree of every (configuration, fold) pair, the pairs of a configuration are adjacent
+	std::vector<std::unique_ptr<Pair>> pairs;
+	std::vector<Timing> timings(configurations.size());
+	std::vector<std::future<void>> pending;
+	ThreadPool pool(std::max<size_t>(1, options.threads));
+	// every job is one tree, the jobs running concurrently share the threads of their large nodes
+	std::vector<BaggingOptions> jobs(configurations);
+	for (auto& config : jobs)
+		config.tree.rowThreads = std::max<size_t>(1, config.tree.rowThreads / pool.size());
+	for (size_t c = 0; c < configurations.size(); c++) {
+		const BaggingOptions& config = jobs[c];
+		for (size_t f = 0; f < k; f++) {
+			pairs.push_back(std::make_unique<Pair>());
+			Pair* pair = pairs.back().get();
+			pair->trees.resize(config.ensembleSize);
+			pair->remaining = config.ensembleSize;
+			// the trees of a pair are seeded by the configuration and the fold only
+			std::seed_seq sequence{ static_cast<uint32_t>(config.seed), static_cast<uint32_t>(f) };
+			std::mt19937_64 seeder(sequence);
+			for (int t = 0; t < config.ensembleSize; t++) {
+				const uint64_t seed = seeder();
+				pending.push_back(pool.submit([&dr, &dr_meta = dr.metaData(), &config, &fold = folds[f], &timing = timings[c], pair, t, seed]() {
+					const uint64_t start = now();
+					const uint64_t cpu_start = Metrics::threadCpuNanoseconds();
+					atomicMin(timing.firstStart, start);
+					// bootstrap sample of the fold as row pointers, the encoded rows are not copied
+					std::mt19937_64 generator(seed);
+					std::uniform_int_distribution<size_t> distribution(0, fold.train.size() - 1);
+					std::vector<VecI*> bootstrap(fold.train.size());
+					for (auto& row : bootstrap)
+						row = fold.train[distribution(generator)];
+					TreeOptions tree = config.tree;
+					tree.seed = generator();
+					DecisionTree dt(dr, bootstrap, tree);
+					pair->trees[t] = dt.root_;
+					// the job building the last tree of the pair scores it and frees the trees
+					if (pair->remaining.fetch_sub(1) == 1) {
+						VoteTally tally(fold.validation, dr_meta);
+						for (const auto& tree : pair->trees)
+							tally.add(tree);
+						pair->accuracy = tally.accuracy();
+						pair->logLoss = tally.logLoss();
+						pair->trees = std::vector<Node>();
+					}
+					timing.cpuNs.add(Metrics::threadCpuNanoseconds() - cpu_start);
+					atomicMax(timing.lastEnd, now());
+				}));
+			}
+		}
+	}
+	for (auto& p : pending)
+		p.get();
+
+	std::vector<SearchResult> results;
+	for (size_t c = 0; c < configurations.size(); c++) {
+		SearchResult result;
+		result.options = configurations[c];
+		for (size_t f = 0; f < k; f++) {
+			const Pair& pair = *pairs[c * k + f];
+			result.foldAccuracy.push_back(pair.accuracy);
+			result.accuracy += pair.accuracy / k;
+			result.logLoss += pair.logLoss / k;
+		}
+		for (double accuracy : result.foldAccuracy)
+			result.accuracyStd += (accuracy - result.accuracy) * (accuracy - result.accuracy) / k;
+		result.accuracyStd = std::sqrt(result.accuracyStd);
+		result.cpuSeconds = timings[c].cpuNs.value() / 1e9;
+		if (timings[c].lastEnd > 0)
+			result.wallSeconds = (timings[c].lastEnd - timings[c].firstStart) / 1e9;
+		results.push_back(result);
+	}
+	return results;
+}
+
+std::vector<SearchResult> Tuning::search(const DataReader& dr, const ParameterGrid& parameters, const BaggingOptions& base, const SearchOptions& options) {
+	std::vector<BaggingOptions> configurations = grid(parameters, base);
+	if (options.randomSamples > 0)
+		configurations = sample(configurations, options.randomSamples, options.seed);
+	std::vector<SearchResult> results = crossValidate(dr, configurations, options);
+	std::stable_sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) { return a.accuracy > b.accuracy; });
+	return results;
+}
+
+string Tuning::toTable(const std::vector<SearchResult>& results) {
+	std::ostringstream table;
+	table << std::left << std::setw(44) << "configuration" << std::right
+		<< std::setw(10) << "accuracy" << std::setw(10) << "std" << std::setw(10) << "log-loss"
+		<< std::setw(10) << "cpu s" << std::setw(10) << "wall s" << "\n";
+	table << std::fixed;
+	for (const auto& result : results) {
+		table << std::left << std::setw(44) << describe(result.options) << std::right << std::setprecision(4)
+			<< std::setw(10) << result.accuracy << std::setw(10) << result.accuracyStd << std::setw(10) << result.logLoss
+			<< std::setprecision(3) << std::setw(10) << result.cpuSeconds << std::setw(10) << result.wallSeconds << "\n";
+	}
+	return table.str();
+}
+
+string Tuning::toJson(const std::vector<SearchResult>& results) {
+	std::ostringstream json;
+	json << "[";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& result = results[i];
+		json << (i == 0 ? "" : ", ")
+			<< "{\"trees\": " << result.options.ensembleSize
+			<< ", \"max_depth\": " << result.options.tree.maxDepth
+			<< ", \"min_rows_split\": " << result.options.tree.minRowsSplit
+			<< ", \"extra_trees\": " << (result.options.tree.extraTrees ? "true" : "false")
+			<< ", \"accuracy\": " << result.accuracy
+			<< ", \"accuracy_std\": " << result.accuracyStd
+			<< ", \"log_loss\": " << result.logLoss
+			<< ", \"fold_accuracy\": [";
+		for (size_t f = 0; f < result.foldAccuracy.size(); f++)
+			json << (f == 0 ? "" : ", ") << result.foldAccuracy[f];
+		json << "], \"cpu_s\": " << result.cpuSeconds << ", \"wall_s\": " << result.wallSeconds << "}";
+	}
+	json << "]";
+	return json.str();
+}
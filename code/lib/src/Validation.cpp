@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "TreeTest.hpp"
+#include "Validation.hpp"
+
+using std::string;
+
+namespace {
+	string jsonArray(const std::vector<double>& values) {
+		std::ostringstream json;
+		json << "[";
+		for (size_t i = 0; i < values.size(); i++)
+			json << (i == 0 ? "" : ", ") << values[i];
+		json << "]";
+		return json.str();
+	}
+}
+
+VoteTally::VoteTally(const Data& rows, const MetaData& meta) :
+	rows_(rows),
+	classes_(meta.classNames.size()),
+	labels_(rows.size(), -1),
+	votes_(rows.size() * classes_, 0),
+	frequencies_(rows.size() * classes_, 0.0),
+	trees_(rows.size(), 0) {
+	// the class ids are the ids of the decision column
+	const auto& classIds = meta.mapS2I.back();
+	for (size_t row = 0; row < rows.size(); row++) {
+		if (auto id = classIds.find(rows[row].back()); id != classIds.end())
+			labels_[row] = id->second;
+	}
+}
+
+void VoteTally::add(const Node& root, const std::vector<bool>& skip) {
+	TreeTest t;
+	for (size_t row = 0; row < rows_.size(); row++) {
+		if (labels_[row] < 0 || (!skip.empty() && skip[row]))
+			continue;
+		const Leaf& leaf = t.classify(rows_[row], root);
+		const double total = leaf.total();
+		votes_[row * classes_ + leaf.prediction()]++;
+		// leaves of trees trained before new classes were merged hold fewer counts
+		for (size_t id = 0; id < leaf.counts().size() && total > 0; id++)
+			frequencies_[row * classes_ + id] += leaf.counts()[id] / total;
+		trees_[row]++;
+	}
+}
+
+double VoteTally::accuracy() const {
+	size_t correct = 0, scored = 0;
+	for (size_t row = 0; row < rows_.size(); row++) {
+		if (labels_[row] < 0 || trees_[row] == 0)
+			continue;
+		const auto first = votes_.begin() + row * classes_;
+		correct += std::distance(first, std::max_element(first, first + classes_)) == labels_[row];
+		scored++;
+	}
+	return scored > 0 ? static_cast<double>(correct) / scored : 0;
+}
+
+double VoteTally::logLoss() const {
+	double loss = 0;
+	size_t scored = 0;
+	for (size_t row = 0; row < rows_.size(); row++) {
+		if (labels_[row] < 0 || trees_[row] == 0)
+			continue;
+		// pure leaves give a probability of 0 to the other classes, it is clipped
+		const double p = frequencies_[row * classes_ + labels_[row]] / trees_[row];
+		loss -= std::log(std::max(p, 1e-15));
+		scored++;
+	}
+	return scored > 0 ? loss / scored : 0;
+}
+
+size_t VoteTally::rowsScored() const {
+	return std::count_if(trees_.begin(), trees_.end(), [](uint32_t n) { return n > 0; });
+}
+
+string EarlyStoppingReport::toJson() const {
+	std::ostringstream json;
+	json << "{\"stopped\": " << (stopped ? "true" : "false")
+		<< ", \"trees_trained\": " << treesTrained
+		<< ", \"trees_kept\": " << treesKept
+		<< ", \"accuracy\": " << jsonArray(accuracy)
+		<< ", \"log_loss\": " << jsonArray(logLoss) << "}";
+	return json.str();
+}
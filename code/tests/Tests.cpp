@@ -0,0 +1,162 @@
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Bagging.hpp"
+#include "Compaction.hpp"
+#include "DataReader.hpp"
+#include "Distributed.hpp"
+#include "FlatTree.hpp"
+#include "Serialization.hpp"
+#include "SyntheticData.hpp"
+#include "TreeTest.hpp"
+
+namespace {
+
+	void check(bool condition, const std::string& message) {
+		if (!condition)
+			throw std::runtime_error(message);
+	}
+
+	// a small data set of its own for every test, so that the tests can run concurrently
+	Dataset writeData(const std::string& directory) {
+		std::filesystem::create_directories(directory);
+		SyntheticSpec spec;
+		spec.rows = 2000;
+		spec.testRows = 500;
+		spec.numericColumns = 4;
+		spec.categoricalColumns = 3;
+		spec.classes = 3;
+		return Synthetic::writeDataset(directory, spec);
+	}
+
+	BaggingOptions options(int trees) {
+		BaggingOptions o;
+		o.ensembleSize = trees;
+		o.seed = 99;
+		o.threads = 2;
+		return o;
+	}
+
+	std::string text(const Node& root) {
+		std::ostringstream out;
+		Serialization::writeTree(out, root);
+		return out.str();
+	}
+
+	void checkSameLeaf(const Leaf& expected, const Leaf& actual, const std::string& what) {
+		check(expected.counts() == actual.counts() && expected.prediction() == actual.prediction(), what + " reached another leaf");
+	}
+
+	// a saved and loaded model predicts what the trained model predicts
+	void serialization() {
+		const DataReader dr(writeData("serialization"));
+		const Bagging trained(dr, options(5));
+		trained.save("serialization/model");
+		const Bagging loaded = Bagging::load("serialization/model");
+		check(loaded.size() == trained.size(), "the loaded model has another number of trees");
+		check(loaded.seed() == trained.seed() && loaded.seedsDrawn() == trained.seedsDrawn(), "the seeds were not saved");
+		check(loaded.metaData().classNames == trained.metaData().classNames, "the classes were not saved");
+		for (size_t i = 0; i < trained.size(); i++)
+			check(text(loaded.trees()[i]) == text(trained.trees()[i]), "tree " + std::to_string(i) + " changed");
+		for (const auto& row : dr.testData())
+			check(loaded.predict(row) == trained.predict(row), "the loaded model predicts another class");
+	}
+
+	// the slices of the workers merge into the ensemble of a single process
+	void distributed() {
+		const DataReader dr(writeData("distributed"));
+		const BaggingOptions o = options(6);
+		const Bagging single(dr, o);
+		std::stringstream first, second;
+		Bagging::trainSlice(dr, o, 0, 2, first);
+		Bagging::trainSlice(dr, o, 2, 6, second);
+		// the slices may arrive in any order
+		const Bagging merged = Distributed::merge(dr, o, { &second, &first });
+		check(merged.size() == single.size(), "the merged model has another number of trees");
+		for (size_t i = 0; i < single.size(); i++)
+			check(text(merged.trees()[i]) == text(single.trees()[i]), "merged tree " + std::to_string(i) + " differs");
+		check(merged.seedsDrawn() == single.seedsDrawn(), "the merged model drew other seeds");
+	}
+
+	// grown trees never reuse the seed of a tree of the ensemble, also once a window dropped trees
+	void grow() {
+		const DataReader dr(writeData("grow"));
+		const BaggingOptions o = options(2);
+		Bagging(dr, options(4)).save("grow/model");
+		for (int round = 0; round < 2; round++) {
+			Bagging model = Bagging::load("grow/model");
+			check(model.grow(dr, o, 4) == 2, "grow did not add the trees");
+			check(model.size() == 4, "the window did not drop the oldest trees");
+			model.save("grow/model");
+		}
+		const Bagging model = Bagging::load("grow/model");
+		check(model.seedsDrawn() == 8, "grow drew " + std::to_string(model.seedsDrawn()) + " seeds instead of 8");
+		// a tree is determined by its seed on the same data, equal trees share their seed
+		for (size_t i = 0; i < model.size(); i++) {
+			for (size_t j = i + 1; j < model.size(); j++)
+				check(text(model.trees()[i]) != text(model.trees()[j]), "trees " + std::to_string(i) + " and " + std::to_string(j) + " share their seed");
+		}
+	}
+
+	// the compiled trees, in both layouts, reach the leaves the Node graph reaches
+	void flatTree() {
+		const DataReader dr(writeData("flat_tree"));
+		const Bagging model(dr, options(5));
+		const MetaData& meta = model.metaData();
+		const TreeTest walker;
+		for (const auto& root : model.trees()) {
+			const FlatTree depthFirst(root, meta);
+			const FlatTree guided(root, meta, dr.trainData());
+			for (const auto& row : dr.testData()) {
+				const Leaf& expected = walker.classify(row, root);
+				const FlatRow encoded = FlatTree::encode(row, meta);
+				checkSameLeaf(expected, depthFirst.classify(encoded), "the depth first flat tree");
+				checkSameLeaf(expected, guided.classify(encoded), "the guided flat tree");
+			}
+		}
+	}
+
+	// the compacted trees reach the leaves of the original trees and share their identical subtrees
+	void compaction() {
+		const DataReader dr(writeData("compaction"));
+		const Bagging model(dr, options(5));
+		std::vector<Node> compacted = model.trees();
+		const CompactionReport report = Compaction::compact(compacted);
+		check(report.trees == model.size(), "the report counts another number of trees");
+		check(report.nodes == model.nodeCount(), "the report counts another number of nodes");
+		check(report.distinctNodes < report.nodes && report.bytesAfter < report.bytesBefore, "no subtree was shared");
+		const TreeTest walker;
+		for (size_t i = 0; i < compacted.size(); i++) {
+			check(text(compacted[i]) == text(model.trees()[i]), "compacted tree " + std::to_string(i) + " changed");
+			for (const auto& row : dr.testData())
+				checkSameLeaf(walker.classify(row, model.trees()[i]), walker.classify(row, compacted[i]), "the compacted tree");
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const std::map<std::string, std::function<void()>> tests{
+		{ "serialization", serialization },
+		{ "distributed", distributed },
+		{ "grow", grow },
+		{ "flat_tree", flatTree },
+		{ "compaction", compaction },
+	};
+	if (argc != 2 || tests.count(argv[1]) == 0) {
+		std::cerr << "Usage: DecisionTreeTests serialization|distributed|grow|flat_tree|compaction\n";
+		return 2;
+	}
+	try {
+		tests.at(argv[1])();
+	}
+	catch (const std::exception& e) {
+		std::cerr << argv[1] << ": " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}